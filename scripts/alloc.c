@@ -0,0 +1,634 @@
+#include "alloc.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ir.h"
+#include "sched.h"
+
+AllocStats alloc_stats;
+
+static int k_regs;    // number of allocatable PRs
+static int reserved;  // PR holding spill addresses, -1 if no spills
+
+static int *VRToPR;
+static int PRToVR[MAX_K];
+static int PRNU[MAX_K];
+static uint64_t marked;  // bit pr set while pr is an operand of the current op
+static uint64_t clean;   // bit pr set when its value costs nothing to spill
+static int *VRConst;     // constant for VRs defined by loadI, -1 otherwise
+static int *VRToSlot;    // spill address of a VR, -1 if never stored
+
+// live-range splitting: hot is the first op after the current one where
+// more VRs are live than there are PRs, so a value idle across it forces
+// an eviction somewhere
+static int hot;
+static int cur;  // index of the operation being allocated
+
+static int free_prs[MAX_K];  // stack of free PRs
+static int free_top;
+
+// spill slot manager: slots of dead VRs are pushed here and handed out
+// again before the region grows, so the spill area stays small and dense
+static int *free_slots;
+static int free_slot_top;
+static int next_slot;
+static int res_addr;  // address currently held in the reserved PR, -1 if none
+
+// restore hoisting: spilled values wait in their slots in a min-heap on
+// next use, so once pressure drops a free PR can reload the value needed
+// soonest well ahead of its use instead of right in front of it
+typedef struct {
+    int nu, vr;
+} Waiting;
+
+static Waiting *waiting;
+static int wait_top, wait_cap;
+static int *VRWaitNU;    // next use a spilled VR waits in its slot for, -1 otherwise
+static int *VRLoadedAt;  // output position of a hoisted restore not yet used, -1 otherwise
+static int emitted;      // operations and spill code output so far
+
+// fused mode prints each operation, spill code first, as it is allocated
+// instead of inserting spill code into the IR
+static int fused;
+
+// replaying (alloc_replay) runs fused mode but only notes, for each line
+// it would print, the index of the operation being allocated
+static int *line_op;
+static int line_count, line_cap;
+
+// stall feedback: simulator stall cycles charged to each operation, by
+// index; NULL when no profile was loaded
+static const int *stall_at;
+
+/*
+Output: allocated ILOC is formatted into one buffer and written in blocks
+*/
+
+static char out[1 << 16];
+static int out_len;
+
+static void out_flush(void) {
+    fwrite(out, 1, out_len, stdout);
+    out_len = 0;
+}
+
+static inline void out_str(const char *str) {
+    while (*str) out[out_len++] = *str++;
+}
+
+static inline void out_int(int v) {
+    char digits[12];
+    int n = 0;
+    unsigned u = (unsigned)v;
+    if (v < 0) {
+        out[out_len++] = '-';
+        u = -u;
+    }
+    do {
+        digits[n++] = (char)('0' + u % 10);
+        u /= 10;
+    } while (u);
+    while (n) out[out_len++] = digits[--n];
+}
+
+static inline void out_reg(int pr) {
+    out[out_len++] = 'r';
+    out_int(pr);
+}
+
+// one allocated operation: a is a constant for loadI and output, else a PR
+static void out_op(IROpcode op, int a, int b, int c) {
+    static const char *const arith[] = {
+        [IR_ADD] = "add\t", [IR_SUB] = "sub\t", [IR_MULT] = "mult\t",
+        [IR_LSHIFT] = "lshift\t", [IR_RSHIFT] = "rshift\t",
+    };
+
+    // longest line: an opcode and three registers or constants
+    if (out_len > (int)sizeof(out) - 64) out_flush();
+    switch (op) {
+        case IR_LOADI:
+            out_str("loadI\t");
+            out_int(a);
+            out_str("\t=> ");
+            out_reg(c);
+            break;
+        case IR_LOAD:
+        case IR_STORE:
+            out_str(op == IR_LOAD ? "load\t" : "store\t");
+            out_reg(a);
+            out_str("\t=> ");
+            out_reg(c);
+            break;
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MULT:
+        case IR_LSHIFT:
+        case IR_RSHIFT:
+            out_str(arith[op]);
+            out_reg(a);
+            out_str(", ");
+            out_reg(b);
+            out_str("\t=> ");
+            out_reg(c);
+            break;
+        case IR_OUTPUT:
+            out_str("output\t");
+            out_int(a);
+            break;
+        default:
+            out_str("nop");
+            break;
+    }
+    out[out_len++] = '\n';
+}
+
+static void out_node(IRNode *p) {
+    int a = p->opcode == IR_LOADI || p->opcode == IR_OUTPUT ? p->op1.sr : p->op1.pr;
+    out_op(p->opcode, a, p->op2.pr, p->op3.pr);
+}
+
+static void note_line(void) {
+    if (line_count == line_cap) {
+        line_cap *= 2;
+        line_op = realloc(line_op, line_cap * sizeof(int));
+    }
+    line_op[line_count++] = cur;
+}
+
+// spill code goes in before pos, or out ahead of it when fused; src is
+// a constant for loadI and a PR otherwise
+static void spill_code(IRNode *pos, IROpcode op, int src, int dst, int addr) {
+    emitted++;
+    if (fused) {
+        if (line_op)
+            note_line();
+        else
+            out_op(op, src, -1, dst);
+        return;
+    }
+    IRNode *n = ir_insert_before(pos, op, pos->line);
+    if (op == IR_LOADI)
+        n->op1.sr = src;
+    else
+        n->op1.pr = src;
+    n->op3.pr = dst;
+    n->addr = addr;
+}
+
+/*
+Spill slot manager
+*/
+
+static int slot_alloc(void) {
+    if (free_slot_top > 0) return free_slots[--free_slot_top];
+    alloc_stats.slots++;
+    int addr = next_slot;
+    next_slot += SPILL_WORD;
+    return addr;
+}
+
+// VR is dead; its slot can hold another value
+static void slot_release(int vr) {
+    if (VRToSlot[vr] == -1) return;
+    free_slots[free_slot_top++] = VRToSlot[vr];
+    VRToSlot[vr] = -1;
+}
+
+// get addr into the reserved PR, skipping the loadI when it is already there
+static void load_spill_addr(IRNode *pos, int addr) {
+    if (res_addr == addr) {
+        alloc_stats.addr_reused++;
+        return;
+    }
+    spill_code(pos, IR_LOADI, addr, reserved, -1);
+    res_addr = addr;
+}
+
+/*
+Restore hoisting
+*/
+
+static void wait_push(int nu, int vr) {
+    if (wait_top == wait_cap) {
+        wait_cap = wait_cap ? 2 * wait_cap : 64;
+        waiting = realloc(waiting, wait_cap * sizeof(Waiting));
+    }
+    int i = wait_top++;
+    while (i > 0 && waiting[(i - 1) / 2].nu > nu) {
+        waiting[i] = waiting[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    waiting[i] = (Waiting){nu, vr};
+    VRWaitNU[vr] = nu;
+}
+
+static void wait_pop(void) {
+    Waiting last = waiting[--wait_top];
+    int i = 0;
+    for (;;) {
+        int c = 2 * i + 1;
+        if (c >= wait_top) break;
+        if (c + 1 < wait_top && waiting[c + 1].nu < waiting[c].nu) c++;
+        if (waiting[c].nu >= last.nu) break;
+        waiting[i] = waiting[c];
+        i = c;
+    }
+    if (wait_top > 0) waiting[i] = last;
+}
+
+/*
+Physical register management
+*/
+
+static void free_pr(int pr) {
+    VRToPR[PRToVR[pr]] = -1;
+    PRToVR[pr] = -1;
+    PRNU[pr] = INT_MAX;
+    free_prs[free_top++] = pr;
+}
+
+// move the value in pr to memory so pr can be reused
+static void spill(int pr, IRNode *pos) {
+    int vr = PRToVR[pr];
+
+    // constants are rematerialized, and a VR never changes after its
+    // definition, so a value already in its slot needs no second store
+    if (VRConst[vr] == -1 && VRToSlot[vr] == -1) {
+        VRToSlot[vr] = slot_alloc();
+        load_spill_addr(pos, VRToSlot[vr]);
+
+        spill_code(pos, IR_STORE, pr, reserved, VRToSlot[vr]);
+        alloc_stats.spills++;
+    }
+    if (VRConst[vr] == -1 && PRNU[pr] != INT_MAX) wait_push(PRNU[pr], vr);
+    VRLoadedAt[vr] = -1;
+
+    VRToPR[vr] = -1;
+    PRToVR[pr] = -1;
+}
+
+static void restore(int vr, int pr, IRNode *pos) {
+    if (VRConst[vr] != -1) {
+        spill_code(pos, IR_LOADI, VRConst[vr], pr, -1);
+        alloc_stats.remats++;
+        return;
+    }
+
+    // used before any definition in the block; there is nothing to reload
+    if (VRToSlot[vr] == -1) return;
+
+    load_spill_addr(pos, VRToSlot[vr]);
+    spill_code(pos, IR_LOAD, reserved, pr, VRToSlot[vr]);
+    alloc_stats.restores++;
+}
+
+// with a stall profile, spill code at an operation that stalled is
+// likely waiting on a store, so values that must be stored count as
+// nearer by the stall cycles there: their distance is scaled by
+// STALL_SCALE / (STALL_SCALE + stalls) and a clean value further down
+// the ranking is evicted instead
+static int pick_victim_stalled(void) {
+    int best = -1;
+    int best_clean = 0;
+    long best_score = 0;
+    int w = stall_at[cur];
+
+    for (int pr = 0; pr < k_regs; pr++) {
+        if (marked >> pr & 1) continue;
+        int c = clean >> pr & 1;
+        long score = LONG_MAX;
+        if (PRNU[pr] != INT_MAX)
+            score = (long)(PRNU[pr] - cur) * STALL_SCALE / (STALL_SCALE + (c ? 0 : w));
+        if (best == -1 || score > best_score || (score == best_score && c && !best_clean)) {
+            best = pr;
+            best_clean = c;
+            best_score = score;
+        }
+    }
+    return best;
+}
+
+// choose the unmarked PR whose value is needed furthest away,
+// preferring values that cost nothing to spill
+static int pick_victim(void) {
+    if (stall_at) return pick_victim_stalled();
+
+    int best = -1;
+    int best_clean = 0;
+
+    for (int pr = 0; pr < k_regs; pr++) {
+        if (marked >> pr & 1) continue;
+        int c = clean >> pr & 1;
+        if (best == -1 || PRNU[pr] > PRNU[best] || (PRNU[pr] == PRNU[best] && c && !best_clean)) {
+            best = pr;
+            best_clean = c;
+        }
+    }
+    return best;
+}
+
+static int get_pr(int vr, int nu, IRNode *pos) {
+    int pr;
+
+    if (free_top > 0) {
+        pr = free_prs[--free_top];
+    } else {
+        pr = pick_victim();
+        spill(pr, pos);
+    }
+
+    VRToPR[vr] = pr;
+    PRToVR[pr] = vr;
+    PRNU[pr] = nu;
+    // a value keeps its constant and slot for as long as it holds pr
+    if (VRConst[vr] != -1 || VRToSlot[vr] != -1)
+        clean |= (uint64_t)1 << pr;
+    else
+        clean &= ~((uint64_t)1 << pr);
+    return pr;
+}
+
+// make sure a used VR is in a PR and mark it for this operation
+static void alloc_use(IROperand *op, IRNode *pos) {
+    int pr = VRToPR[op->vr];
+    if (pr == -1) {
+        pr = get_pr(op->vr, op->nu, pos);
+        restore(op->vr, pr, pos);
+        VRWaitNU[op->vr] = -1;
+    } else {
+        PRNU[pr] = op->nu;
+        // an early restore only counts as hoisted when something was
+        // output between the load and this use, and as hidden once the
+        // load has had its full latency of single-cycle ops ahead of it
+        if (VRLoadedAt[op->vr] != -1) {
+            if (emitted - VRLoadedAt[op->vr] > 1) alloc_stats.hoisted++;
+            if (emitted - VRLoadedAt[op->vr] >= LAT_LOAD) alloc_stats.hidden++;
+            VRLoadedAt[op->vr] = -1;
+        }
+    }
+    op->pr = pr;
+    marked |= (uint64_t)1 << pr;
+}
+
+// after the current op, reload spilled values into free PRs, soonest
+// use first. A value only goes up when no op before its use has more
+// values live than PRs, so holding it early never forces an eviction;
+// the load then has every op in between to complete. A value used by
+// the very next op has nothing in between, and alloc_use counts it as
+// an ordinary restore
+static void hoist_restores(IRNode *pos) {
+    while (free_top > 0 && wait_top > 0) {
+        Waiting w = waiting[0];
+        if (VRWaitNU[w.vr] != w.nu) {
+            wait_pop();  // restored at a use or redefined since
+            continue;
+        }
+        if (w.nu > hot) break;
+        wait_pop();
+        VRWaitNU[w.vr] = -1;
+        restore(w.vr, get_pr(w.vr, w.nu, pos), pos);
+        VRLoadedAt[w.vr] = emitted - 1;
+    }
+}
+
+// a value idle from cur until nu, across a point of excess pressure
+static inline int idle_gap(int nu) {
+    return reserved != -1 && nu != INT_MAX && nu - cur >= SPLIT_GAP && hot < nu;
+}
+
+// free the PR of a use at its last use, or split a constant's range
+// when it would sit idle through a long stretch of high pressure
+static void end_use(IROperand *op) {
+    if (VRToPR[op->vr] == -1) return;
+    if (op->nu == INT_MAX) {
+        free_pr(op->pr);
+        slot_release(op->vr);
+    } else if (VRConst[op->vr] != -1 && idle_gap(op->nu)) {
+        free_pr(op->pr);
+        alloc_stats.splits++;
+    }
+}
+
+// returns 0 when the definition was dropped and n should be removed
+static int alloc_def(IRNode *n) {
+    // streaming reuses a VR number for each definition of its register
+    VRConst[n->op3.vr] = -1;
+    VRWaitNU[n->op3.vr] = -1;
+    VRLoadedAt[n->op3.vr] = -1;
+    if (n->opcode == IR_LOADI) {
+        VRConst[n->op3.vr] = n->op1.sr;
+        // rematerialize at the first use instead of holding a PR until then
+        if (idle_gap(n->op3.nu)) {
+            alloc_stats.splits++;
+            return 0;
+        }
+    }
+
+    n->op3.pr = get_pr(n->op3.vr, n->op3.nu, n);
+
+    // a value that is never used only needs its PR for this operation
+    if (n->op3.nu == INT_MAX) free_pr(n->op3.pr);
+    return 1;
+}
+
+void alloc_begin(int k, int nvr, int live, int emit) {
+    fused = emit;
+    // keep one PR back for spill addresses only when spills can happen
+    if (live > k) {
+        k_regs = k - 1;
+        reserved = k - 1;
+    } else {
+        k_regs = k;
+        reserved = -1;
+    }
+
+    if (nvr < 1) nvr = 1;
+    VRToPR = malloc(nvr * sizeof(int));
+    VRConst = malloc(nvr * sizeof(int));
+    VRToSlot = malloc(nvr * sizeof(int));
+    free_slots = malloc(nvr * sizeof(int));
+    VRWaitNU = malloc(nvr * sizeof(int));
+    VRLoadedAt = malloc(nvr * sizeof(int));
+    for (int i = 0; i < nvr; i++) {
+        VRToPR[i] = -1;
+        VRConst[i] = -1;
+        VRToSlot[i] = -1;
+        VRWaitNU[i] = -1;
+        VRLoadedAt[i] = -1;
+    }
+    wait_top = 0;
+    emitted = 0;
+
+    marked = 0;
+    clean = 0;
+    free_top = 0;
+    for (int pr = k_regs - 1; pr >= 0; pr--) {
+        PRToVR[pr] = -1;
+        PRNU[pr] = INT_MAX;
+        free_prs[free_top++] = pr;
+    }
+
+    free_slot_top = 0;
+    next_slot = SPILL_BASE;
+    res_addr = -1;
+}
+
+int alloc_hot_limit(void) {
+    return k_regs;
+}
+
+int alloc_step(IRNode *n, int index, int next_hot) {
+    int kept = 1;
+    cur = index;
+    hot = next_hot;
+
+    // spill code goes in before n
+    switch (n->opcode) {
+        case IR_LOAD:
+            alloc_use(&n->op1, n);
+            end_use(&n->op1);
+            marked = 0;
+            alloc_def(n);
+            break;
+
+        case IR_LOADI:
+            kept = alloc_def(n);
+            break;
+
+        case IR_STORE:
+            alloc_use(&n->op1, n);
+            alloc_use(&n->op3, n);
+            end_use(&n->op1);
+            end_use(&n->op3);
+            marked = 0;
+            break;
+
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MULT:
+        case IR_LSHIFT:
+        case IR_RSHIFT:
+            alloc_use(&n->op1, n);
+            alloc_use(&n->op2, n);
+            end_use(&n->op1);
+            end_use(&n->op2);
+            marked = 0;
+            alloc_def(n);
+            break;
+
+        default:
+            break;
+    }
+    if (fused && kept) {
+        if (line_op)
+            note_line();
+        else
+            out_node(n);
+    }
+    emitted += kept;
+
+    // hoisted restores go in after n: before the next op in the IR, or
+    // straight out when fused
+    if (reserved != -1) hoist_restores(fused ? n : n->next);
+    return kept;
+}
+
+void alloc_end(void) {
+    if (fused) out_flush();
+    free(VRToPR);
+    free(VRConst);
+    free(VRToSlot);
+    free(free_slots);
+    free(VRWaitNU);
+    free(VRLoadedAt);
+    free(waiting);
+    waiting = NULL;
+    wait_cap = 0;
+}
+
+// next_hot[i] is the first op at or after i with excess pressure
+static int *find_next_hot(void) {
+    int *next_hot = malloc((block_len + 1) * sizeof(int));
+    next_hot[block_len] = INT_MAX;
+    for (int i = block_len - 1; i >= 0; i--) {
+        next_hot[i] = live_at[i] > k_regs ? i : next_hot[i + 1];
+    }
+    return next_hot;
+}
+
+void ir_allocate(int k) {
+    IRNode *head = ir_head();
+
+    alloc_begin(k, vr_count, max_live, 0);
+    int *next_hot = find_next_hot();
+
+    // spill code goes in before n, so next is never an inserted node
+    IRNode *next;
+    int index = 0;
+    for (IRNode *n = head->next; n != head; n = next, index++) {
+        next = n->next;
+        if (!alloc_step(n, index, next_hot[index + 1])) remove_from_node_list(n);
+    }
+
+    free(next_hot);
+    alloc_end();
+}
+
+void ir_allocate_emit(int k) {
+    IRNode *head = ir_head();
+
+    alloc_begin(k, vr_count, max_live, 1);
+    int *next_hot = find_next_hot();
+
+    int index = 0;
+    for (IRNode *n = head->next; n != head; n = n->next, index++) {
+        alloc_step(n, index, next_hot[index + 1]);
+    }
+
+    free(next_hot);
+    alloc_end();
+}
+
+int *alloc_replay(int k, int *lines) {
+    const int *weights = stall_at;
+
+    line_cap = block_len > 0 ? block_len : 1;
+    line_op = malloc(line_cap * sizeof(int));
+    line_count = 0;
+    stall_at = NULL;
+    ir_allocate_emit(k);
+    stall_at = weights;
+
+    int *map = line_op;
+    *lines = line_count;
+    line_op = NULL;
+    return map;
+}
+
+void alloc_stall_weights(const int *weights) {
+    stall_at = weights;
+}
+
+void ir_alloc_print(void) {
+    IRNode *head = ir_head();
+
+    for (IRNode *p = head->next; p != head; p = p->next) {
+        if (p->next == head || !p->next->bundled) {
+            out_node(p);
+            continue;
+        }
+        // a bundle: "[ op ; op ]", each op without its newline
+        out_str("[ ");
+        out_node(p);
+        out_len--;
+        out_str(" ; ");
+        p = p->next;
+        out_node(p);
+        out_len--;
+        out_str(" ]\n");
+    }
+    out_flush();
+}
@@ -0,0 +1,67 @@
+#ifndef ALLOC_H
+#define ALLOC_H
+
+#include "ir.h"
+
+// spilled values live at SPILL_BASE and up, above any address the
+// report blocks touch (they use 1024+)
+#define SPILL_BASE 32768
+#define SPILL_WORD 4
+
+// largest k main accepts; the register file is sized for it
+#define MAX_K 64
+
+// a constant idle for at least this many operations across high pressure
+// gives up its PR and is rematerialized at the next use
+#define SPLIT_GAP 4
+
+// at an operation that stalled s cycles, a value that must be stored to
+// be evicted counts as STALL_SCALE / (STALL_SCALE + s) as far from its
+// next use (--stall-profile)
+#define STALL_SCALE 4
+
+typedef struct {
+    int spills;       // stores emitted for spilled values
+    int restores;     // loads emitted to bring values back
+    int remats;       // restores done with loadI instead of a load
+    int slots;        // distinct spill slots handed out
+    int addr_reused;  // loadI of a spill address skipped (already in reserved PR)
+    int splits;       // constant live ranges split at an idle gap
+    int hoisted;      // restores issued ahead of their use once pressure dropped,
+                      // with at least one line between the load and the use
+    int hidden;       // hoisted restores a full load latency ahead of their use
+} AllocStats;
+
+extern AllocStats alloc_stats;
+
+// allocate the renamed IR onto k physical registers
+void ir_allocate(int k);
+
+// allocate and print in one walk: spill code goes straight to the output
+// and the IR is left without it, so nothing can run on the result after
+void ir_allocate_emit(int k);
+
+// one operation at a time, for callers that hold only part of the block
+// (stream.c): start with nvr VR numbers and the block's max_live, then
+// allocate each op given its index and the index of the next op after it
+// with more than alloc_hot_limit() values live. alloc_step returns 0 when
+// the op was dropped and should not be printed. With emit set, alloc_step
+// prints each op and its spill code itself, and alloc_end flushes them
+void alloc_begin(int k, int nvr, int live, int emit);
+int alloc_hot_limit(void);
+int alloc_step(IRNode *n, int index, int next_hot);
+void alloc_end(void);
+
+// run the plain fused allocation without printing and return, for each
+// line it would print, the index of the operation that line belongs to
+// (spill code belongs to the operation it precedes); *lines gets the count
+int *alloc_replay(int k, int *lines);
+
+// bias victim choice by simulator stall cycles per operation index
+// (stalls.h); weights must cover the block and outlive the allocation
+void alloc_stall_weights(const int *weights);
+
+// print the allocated IR, bundled operations (ir_bundle) as [ op ; op ]
+void ir_alloc_print(void);
+
+#endif
@@ -0,0 +1,24 @@
+#!/bin/bash
+# usage: bench.sh "blocks" binary...
+# best of 5 wall-clock times per block at k = 15, the graders' k
+blocks=$1
+shift
+
+printf "%-14s" "block"
+for b in "$@"; do printf "%18s" "$b"; done
+printf "\n"
+
+for f in $blocks; do
+    printf "%-14s" "$(basename "$f")"
+    for b in "$@"; do
+        best=
+        for i in 1 2 3 4 5; do
+            t0=$(date +%s%N)
+            ./"$b" 15 "$f" > /dev/null
+            t=$(( ($(date +%s%N) - t0) / 1000 ))
+            if [ -z "$best" ] || [ "$t" -lt "$best" ]; then best=$t; fi
+        done
+        printf "%15d us" "$best"
+    done
+    printf "\n"
+done
@@ -0,0 +1,31 @@
+#!/bin/bash
+# usage: bundle.sh "blocks" "ks" simdir
+# cycles for -s on the lab 2 simulator (sim) against --bundle on the lab 3
+# one (sim3) for every block and k; the outputs must match the input's
+blocks=$1
+ks=$2
+sim=$3
+
+printf "%-14s %4s %10s %10s %8s\n" "block" "k" "-s" "--bundle" "saved"
+total_1=0
+total_3=0
+for f in $blocks; do
+    in=$(grep -h "SIM INPUT" "$f" | sed 's/.*INPUT://')
+    ref=$("$sim"/sim $in < "$f" | grep -v cycles)
+    for k in $ks; do
+        out1=$(./412alloc -s "$k" "$f" | "$sim"/sim -r "$k" $in)
+        out3=$(./412alloc --bundle "$k" "$f" | "$sim"/sim3 -r "$k" $in)
+        if [ "$(echo "$out3" | grep -v cycles)" != "$ref" ]; then
+            printf "%-14s %4d %s\n" "$(basename "$f")" "$k" "bundled output differs"
+            continue
+        fi
+        c1=$(echo "$out1" | awk '/cycles/ { print $(NF - 1) }')
+        c3=$(echo "$out3" | awk '/cycles/ { print $(NF - 1) }')
+        printf "%-14s %4d %10d %10d %8s\n" "$(basename "$f")" "$k" "$c1" "$c3" \
+            "$(awk -v a="$c1" -v b="$c3" 'BEGIN { printf "%.1f%%", a ? 100 * (a - b) / a : 0 }')"
+        total_1=$((total_1 + c1))
+        total_3=$((total_3 + c3))
+    done
+done
+printf "%-14s %4s %10d %10d %8s\n" "total" "" "$total_1" "$total_3" \
+    "$(awk -v a=$total_1 -v b=$total_3 'BEGIN { printf "%.1f%%", a ? 100 * (a - b) / a : 0 }')"
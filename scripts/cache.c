@@ -0,0 +1,288 @@
+#include "cache.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ir.h"
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t input_hash;  // FNV-1a of the input file
+    uint64_t input_size;
+    uint32_t ops;         // block_len
+    uint32_t vrs;         // vr_count
+    uint32_t max_live;
+    uint32_t line_bytes;  // sizes of the varint sections
+    uint32_t operand_bytes;
+    uint32_t live_bytes;
+} CacheHeader;
+
+/*
+Varints: 7 bits per byte, low bits first, high bit set on all but the last
+*/
+
+typedef struct {
+    unsigned char *buf;
+    size_t len, cap;
+} VarBuf;
+
+static void put_varint(VarBuf *b, uint32_t v) {
+    if (b->len + 5 > b->cap) {
+        b->cap = b->cap ? 2 * b->cap : 4096;
+        b->buf = realloc(b->buf, b->cap);
+    }
+    while (v >= 0x80) {
+        b->buf[b->len++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    b->buf[b->len++] = (unsigned char)v;
+}
+
+// returns 0 when the varint runs past end
+static inline int get_varint(const unsigned char **p, const unsigned char *end, uint32_t *v) {
+    uint32_t x = 0;
+    for (int shift = 0; shift < 35 && *p < end; shift += 7) {
+        unsigned char c = *(*p)++;
+        x |= (uint32_t)(c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            *v = x;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// signed values (line deltas) zigzag so small negatives stay short
+static inline uint32_t zigzag(int v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int unzigzag(uint32_t v) {
+    return (int)(v >> 1) ^ -(int)(v & 1);
+}
+
+/*
+Cache keys
+*/
+
+static int hash_file(const char *filename, uint64_t *hash, uint64_t *size) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return 0;
+    }
+
+    uint64_t h = 14695981039346656037ULL;
+    if (st.st_size > 0) {
+        const unsigned char *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            close(fd);
+            return 0;
+        }
+        for (off_t i = 0; i < st.st_size; i++) {
+            h ^= p[i];
+            h *= 1099511628211ULL;
+        }
+        munmap((void *)p, st.st_size);
+    }
+    close(fd);
+
+    *hash = h;
+    *size = (uint64_t)st.st_size;
+    return 1;
+}
+
+static char *cache_path(const char *dir, uint64_t hash) {
+    size_t n = strlen(dir) + 32;
+    char *path = malloc(n);
+    snprintf(path, n, "%s/%016llx.ir", dir, (unsigned long long)hash);
+    return path;
+}
+
+/*
+Register operands per opcode: loadI and output keep a constant in op1.sr
+*/
+
+static inline int uses_op1(IROpcode op) {
+    return op != IR_LOADI && op != IR_OUTPUT && op != IR_NOP;
+}
+
+static inline int uses_op2(IROpcode op) {
+    return op == IR_ADD || op == IR_SUB || op == IR_MULT || op == IR_LSHIFT || op == IR_RSHIFT;
+}
+
+static inline int uses_op3(IROpcode op) {
+    return op != IR_OUTPUT && op != IR_NOP;
+}
+
+// sr, vr, and the distance to the next use (0 for none)
+static void put_operand(VarBuf *b, IROperand *op, int index) {
+    put_varint(b, (uint32_t)op->sr);
+    put_varint(b, (uint32_t)op->vr);
+    put_varint(b, op->nu == INT_MAX ? 0 : (uint32_t)(op->nu - index));
+}
+
+// 0 as well when a field is out of range for a block of n ops over vrs
+// VRs, so a damaged entry can never index past the per-VR arrays
+static int get_operand(const unsigned char **p, const unsigned char *end, IROperand *op,
+                       int index, int n, uint32_t vrs) {
+    uint32_t sr, vr, d;
+    if (!get_varint(p, end, &sr) || !get_varint(p, end, &vr) || !get_varint(p, end, &d))
+        return 0;
+    if (sr > INT_MAX || vr >= vrs || d >= (uint32_t)(n - index)) return 0;
+    op->sr = (int)sr;
+    op->vr = (int)vr;
+    op->nu = d == 0 ? INT_MAX : index + (int)d;
+    return 1;
+}
+
+void ir_cache_save(const char *dir, const char *filename) {
+    CacheHeader h;
+    uint64_t hash, size;
+
+    if (!hash_file(filename, &hash, &size)) return;
+
+    IRNode *head = ir_head();
+    unsigned char *opcodes = malloc(block_len > 0 ? block_len : 1);
+    VarBuf lines = {0}, operands = {0}, live = {0};
+    int index = 0, prev_line = 0;
+
+    for (IRNode *p = head->next; p != head; p = p->next, index++) {
+        opcodes[index] = (unsigned char)p->opcode;
+        put_varint(&lines, zigzag(p->line - prev_line));
+        prev_line = p->line;
+
+        if (!uses_op1(p->opcode) && p->opcode != IR_NOP) put_varint(&operands, (uint32_t)p->op1.sr);
+        if (uses_op1(p->opcode)) put_operand(&operands, &p->op1, index);
+        if (uses_op2(p->opcode)) put_operand(&operands, &p->op2, index);
+        if (uses_op3(p->opcode)) put_operand(&operands, &p->op3, index);
+
+        put_varint(&live, (uint32_t)live_at[index]);
+    }
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, CACHE_MAGIC, 4);
+    h.version = CACHE_VERSION;
+    h.input_hash = hash;
+    h.input_size = size;
+    h.ops = (uint32_t)block_len;
+    h.vrs = (uint32_t)vr_count;
+    h.max_live = (uint32_t)max_live;
+    h.line_bytes = (uint32_t)lines.len;
+    h.operand_bytes = (uint32_t)operands.len;
+    h.live_bytes = (uint32_t)live.len;
+
+    // write under a temporary name so a reader never sees half a file
+    char *path = cache_path(dir, hash);
+    size_t n = strlen(path) + 16;
+    char *tmp = malloc(n);
+    snprintf(tmp, n, "%s.%d", path, (int)getpid());
+
+    FILE *f = fopen(tmp, "wb");
+    int ok = f != NULL;
+    if (ok) {
+        ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+             fwrite(opcodes, 1, block_len, f) == (size_t)block_len &&
+             fwrite(lines.buf, 1, lines.len, f) == lines.len &&
+             fwrite(operands.buf, 1, operands.len, f) == operands.len &&
+             fwrite(live.buf, 1, live.len, f) == live.len;
+        ok = fclose(f) == 0 && ok;
+    }
+    if (!ok || rename(tmp, path) != 0) {
+        fprintf(stderr, "WARNING: could not write IR cache '%s'\n", path);
+        remove(tmp);
+    }
+
+    free(tmp);
+    free(path);
+    free(opcodes);
+    free(lines.buf);
+    free(operands.buf);
+    free(live.buf);
+}
+
+// rebuild the node list from a mapped cache file; 0 if it is malformed
+static int decode(const unsigned char *base, size_t size, const CacheHeader *h) {
+    if (sizeof(CacheHeader) + (size_t)h->ops + h->line_bytes + h->operand_bytes +
+            h->live_bytes != size || h->ops > INT_MAX || h->vrs > INT_MAX ||
+            h->max_live > h->vrs)
+        return 0;
+
+    int n = (int)h->ops;
+    const unsigned char *opcodes = base + sizeof(CacheHeader);
+    const unsigned char *lp = opcodes + n;
+    const unsigned char *lend = lp + h->line_bytes;
+    const unsigned char *op = lend;
+    const unsigned char *oend = op + h->operand_bytes;
+    const unsigned char *vp = oend;
+    const unsigned char *vend = vp + h->live_bytes;
+    int line = 0;
+
+    free(live_at);
+    live_at = malloc((n > 0 ? n : 1) * sizeof(int));
+
+    for (int i = 0; i < n; i++) {
+        IROpcode code = (IROpcode)opcodes[i];
+        uint32_t v;
+
+        if (code > IR_NOP || !get_varint(&lp, lend, &v)) return 0;
+        line += unzigzag(v);
+
+        IRNode *p = ir_build(code, line, 0);
+        if (!uses_op1(code) && code != IR_NOP) {
+            if (!get_varint(&op, oend, &v) || v > INT_MAX) return 0;
+            p->op1.sr = (int)v;
+        }
+        if (uses_op1(code) && !get_operand(&op, oend, &p->op1, i, n, h->vrs)) return 0;
+        if (uses_op2(code) && !get_operand(&op, oend, &p->op2, i, n, h->vrs)) return 0;
+        if (uses_op3(code) && !get_operand(&op, oend, &p->op3, i, n, h->vrs)) return 0;
+
+        if (!get_varint(&vp, vend, &v) || v > h->vrs) return 0;
+        live_at[i] = (int)v;
+    }
+
+    block_len = n;
+    vr_count = (int)h->vrs;
+    max_live = (int)h->max_live;
+    return 1;
+}
+
+int ir_cache_load(const char *dir, const char *filename) {
+    uint64_t hash, size;
+    if (!hash_file(filename, &hash, &size)) return 0;
+
+    char *path = cache_path(dir, hash);
+    int fd = open(path, O_RDONLY);
+    free(path);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    int ok = 0;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(CacheHeader)) {
+        const unsigned char *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (base != MAP_FAILED) {
+            CacheHeader h;
+            memcpy(&h, base, sizeof(h));
+            ok = memcmp(h.magic, CACHE_MAGIC, 4) == 0 && h.version == CACHE_VERSION &&
+                 h.input_hash == hash && h.input_size == size &&
+                 decode(base, st.st_size, &h);
+            munmap((void *)base, st.st_size);
+        }
+    }
+    close(fd);
+
+    // a bad entry may have built part of a block; start over from the source
+    if (!ok) init_node_list();
+    return ok;
+}
@@ -0,0 +1,17 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+// renamed IR cached on disk, one file per input named by the input's hash:
+//   header | opcodes (1 byte each) | lines | operands | live_at
+// with every section after the opcodes a stream of varints
+#define CACHE_MAGIC "I412"
+#define CACHE_VERSION 1
+
+// load the renamed IR for filename from dir; returns 0 (and builds
+// nothing) when there is no valid entry
+int ir_cache_load(const char *dir, const char *filename);
+
+// write the renamed IR for filename into dir
+void ir_cache_save(const char *dir, const char *filename);
+
+#endif
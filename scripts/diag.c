@@ -0,0 +1,98 @@
+#include "diag.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "error.h"
+
+typedef struct {
+    int line;
+    DiagCode code;
+    char arg[DIAG_ARG];
+} Diag;
+
+static const char *const diag_text[] = {
+    [D_BAD_WORD] = "\"%s\" is not a valid word.",
+    [D_UNEXPECTED] = "unexpected df token at line",
+    [D_MEM_SRC] = "Missing source register in load or store.",
+    [D_MEM_INTO] = "Missing '=>' in load or store.",
+    [D_MEM_DST] = "Missing target register in load or store.",
+    [D_MEM_OP] = "Unknown memory operation.",
+    [D_LOADI_CONST] = "Missing constant in loadI.",
+    [D_LOADI_INTO] = "Missing '=>' in loadI.",
+    [D_LOADI_DST] = "Missing target register in loadI.",
+    [D_ARITH_SRC1] = "Missing first source register in %s.",
+    [D_ARITH_COMMA] = "Missing comma in %s.",
+    [D_ARITH_SRC2] = "Missing second source register in %s.",
+    [D_ARITH_INTO] = "Missing '=>' in %s",
+    [D_ARITH_DST] = "Missing target register in %s.",
+    [D_ARITH_OP] = "Unknown arithmetic op.",
+    [D_OUTPUT_CONST] = "Missing constant in output.",
+    [D_EXTRA] = "Extra token at end of line %s.",
+};
+
+static Diag diags[DIAG_MAX];
+static int diag_count;  // errors seen, including those past DIAG_MAX
+
+void diag_error(int line, DiagCode code, const char *arg, int len) {
+    error_flag = 1;
+    if (diag_count++ >= DIAG_MAX) return;
+
+    Diag *d = &diags[diag_count - 1];
+    d->line = line;
+    d->code = code;
+    d->arg[0] = '\0';
+    if (arg) {
+        if (len < 0) len = (int)strlen(arg);
+        if (len > DIAG_ARG - 1) len = DIAG_ARG - 1;
+        memcpy(d->arg, arg, len);
+        d->arg[len] = '\0';
+    }
+}
+
+/*
+Output: messages are formatted into one buffer, written when it fills
+*/
+
+static char out[1 << 16];
+static int out_len;
+
+static void out_drain(void) {
+    for (int done = 0; done < out_len;) {
+        ssize_t n = write(STDERR_FILENO, out + done, out_len - done);
+        if (n <= 0) break;
+        done += (int)n;
+    }
+    out_len = 0;
+}
+
+static void out_printf(const char *fmt, ...) {
+    // room for the longest message with its line number and argument
+    if (out_len > (int)sizeof(out) - 256) out_drain();
+    va_list args;
+    va_start(args, fmt);
+    out_len += vsnprintf(out + out_len, sizeof(out) - out_len, fmt, args);
+    va_end(args);
+}
+
+void diag_reset(void) {
+    diag_count = 0;
+}
+
+void diag_flush(void) {
+    int shown = diag_count < DIAG_MAX ? diag_count : DIAG_MAX;
+    char msg[160];
+
+    // stdout and stderr may share a terminal; keep what was printed first
+    fflush(stdout);
+    fflush(stderr);
+    for (int i = 0; i < shown; i++) {
+        snprintf(msg, sizeof(msg), diag_text[diags[i].code], diags[i].arg);
+        out_printf("ERROR %d:\t%s\n", diags[i].line, msg);
+    }
+    if (diag_count > shown) out_printf("... and %d more errors\n", diag_count - shown);
+    out_drain();
+    diag_count = 0;
+}
@@ -0,0 +1,39 @@
+#ifndef DIAG_H
+#define DIAG_H
+
+// syntax errors are recorded as they are found and written out together;
+// past DIAG_MAX only a count is kept
+#define DIAG_MAX 1000
+#define DIAG_ARG 48  // longest argument kept with an error
+
+typedef enum {
+    D_BAD_WORD,  // the argument is the word read so far
+    D_UNEXPECTED,
+    D_MEM_SRC,
+    D_MEM_INTO,
+    D_MEM_DST,
+    D_MEM_OP,
+    D_LOADI_CONST,
+    D_LOADI_INTO,
+    D_LOADI_DST,
+    D_ARITH_SRC1,  // the argument is the opcode, for every D_ARITH_*
+    D_ARITH_COMMA,
+    D_ARITH_SRC2,
+    D_ARITH_INTO,
+    D_ARITH_DST,
+    D_ARITH_OP,
+    D_OUTPUT_CONST,
+    D_EXTRA,  // the argument is the extra token
+} DiagCode;
+
+// record an error at line and set error_flag; arg (len bytes, or up to
+// its NUL when len is -1) fills in the message, NULL if it takes none
+void diag_error(int line, DiagCode code, const char *arg, int len);
+
+// write the recorded errors to stderr in one go and forget them
+void diag_flush(void);
+
+// forget the recorded errors without writing them
+void diag_reset(void);
+
+#endif
@@ -10,6 +10,11 @@
 
 extern int global_error;
 
+int vr_count = 0;
+int max_live = 0;
+int block_len = 0;
+int *live_at = NULL;
+
 typedef struct IRPool {
     IRNode nodes[POOL_SIZE];  // array of nodes
     int next_free;
@@ -83,7 +88,8 @@ static IRPool *new_pool(void) {
     return p;
 }
 
-IRNode *ir_new_node(IROpcode opcode, int line) {
+// take the next free node from the tail pool
+static IRNode *pool_alloc(IROpcode opcode, int line) {
     IRPool *tail_pool = pool_head->prev;
     if (tail_pool == pool_head || tail_pool->next_free >= POOL_SIZE) {
         tail_pool = new_pool();
@@ -95,12 +101,43 @@ IRNode *ir_new_node(IROpcode opcode, int line) {
     n->opcode = opcode;
 
     memset(&n->op1, -1, 3 * sizeof(IROperand));
+    n->addr = -1;
+    n->bundled = 0;
+
+    return n;
+}
 
+IRNode *ir_new_node(IROpcode opcode, int line) {
+    IRNode *n = pool_alloc(opcode, line);
     insert_into_node_list(n);
+    return n;
+}
 
+IRNode *ir_insert_before(IRNode *pos, IROpcode opcode, int line) {
+    IRNode *n = pool_alloc(opcode, line);
+    n->prev = pos->prev;
+    n->next = pos;
+    pos->prev->next = n;
+    pos->prev = n;
     return n;
 }
 
+// drop every node, keeping the first pool for the nodes that follow
+void ir_reset_nodes(void) {
+    IRPool *first = pool_head->next;
+    while (pool_head->prev != first) {
+        IRPool *p = pool_head->prev;
+        remove_from_pool_list(p);
+        free(p);
+    }
+    if (first != pool_head) first->next_free = 0;
+    init_node_list();
+}
+
+IRNode *ir_head(void) {
+    return node_head;
+}
+
 IRNode *ir_build(IROpcode op, int line, int nops, ...) {
     IRNode *n = ir_new_node(op, line);
 
@@ -203,17 +240,30 @@ void ir_print(void) {
     }
 }
 
+// bind sr to a VR at a use, counting it as newly live if it was not
+static inline void rename_use(IROperand *op, int *SRToVR, int *VRName, int *live) {
+    if (SRToVR[op->sr] == -1) {
+        SRToVR[op->sr] = (*VRName)++;
+        (*live)++;
+    }
+    op->vr = SRToVR[op->sr];
+}
+
 void ir_rename(void) {
     // Note: in a, (b) => c; c is definition, and a, b are uses
     int VRName = 0;
-    int block_len = 0;
     int maxSR = 0;
+    int live = 0;
+
+    max_live = 0;
+    block_len = 0;
 
     // walk through the blocks to compute block length to compute block_len and maxSR
     for (IRNode *p = node_head->next; p != node_head; p = p->next) {
         block_len++;
-        // find max sr
-        if (p->op1.sr > maxSR) maxSR = p->op1.sr;
+        // find max sr; op1 of loadI and output is a constant, not a register
+        if (p->opcode != IR_LOADI && p->opcode != IR_OUTPUT && p->op1.sr > maxSR)
+            maxSR = p->op1.sr;
         if (p->op2.sr > maxSR) maxSR = p->op2.sr;
         if (p->op3.sr > maxSR) maxSR = p->op3.sr;
     }
@@ -229,8 +279,13 @@ void ir_rename(void) {
     }
     int index = block_len - 1;
 
+    free(live_at);
+    live_at = malloc((block_len > 0 ? block_len : 1) * sizeof(int));
+
     // Iterate backward through doubly linked list
     for (IRNode *p = node_head->prev; p != node_head; p = p->prev) {
+        live_at[index] = live;
+
         // handle define
         switch (p->opcode) {
             // define r3
@@ -241,7 +296,13 @@ void ir_rename(void) {
             case IR_MULT:
             case IR_LSHIFT:
             case IR_RSHIFT:
-                if (SRToVR[p->op3.sr] == -1) SRToVR[p->op3.sr] = VRName++;
+                if (SRToVR[p->op3.sr] == -1) {
+                    // dead definition still needs a register for one op
+                    if (live + 1 > live_at[index]) live_at[index] = live + 1;
+                    SRToVR[p->op3.sr] = VRName++;
+                } else {
+                    live--;
+                }
                 p->op3.vr = SRToVR[p->op3.sr];
                 p->op3.nu = LU[p->op3.sr];
                 SRToVR[p->op3.sr] = -1;
@@ -251,13 +312,13 @@ void ir_rename(void) {
             default:
                 break;
         }
-        
-        // handle use
+
+        // handle use; read every next use before updating LU so that an
+        // operation naming one register twice sees the same next use
         switch (p->opcode) {
             // use only r1
             case IR_LOAD:
-                if (SRToVR[p->op1.sr] == -1) SRToVR[p->op1.sr] = VRName++;
-                p->op1.vr = SRToVR[p->op1.sr];
+                rename_use(&p->op1, SRToVR, &VRName, &live);
                 p->op1.nu = LU[p->op1.sr];
                 LU[p->op1.sr] = index;
                 break;
@@ -268,38 +329,35 @@ void ir_rename(void) {
             case IR_MULT:
             case IR_LSHIFT:
             case IR_RSHIFT:
-                // use r1
-                if (SRToVR[p->op1.sr] == -1) SRToVR[p->op1.sr] = VRName++;
-                p->op1.vr = SRToVR[p->op1.sr];
+                rename_use(&p->op1, SRToVR, &VRName, &live);
+                rename_use(&p->op2, SRToVR, &VRName, &live);
                 p->op1.nu = LU[p->op1.sr];
-                LU[p->op1.sr] = index;
-
-                // use r2
-                if (SRToVR[p->op2.sr] == -1) SRToVR[p->op2.sr] = VRName++;
-                p->op2.vr = SRToVR[p->op2.sr];
                 p->op2.nu = LU[p->op2.sr];
+                LU[p->op1.sr] = index;
                 LU[p->op2.sr] = index;
                 break;
 
             // use both r1 and r3
             case IR_STORE:
-                // use r1
-                if (SRToVR[p->op1.sr] == -1) SRToVR[p->op1.sr] = VRName++;
-                p->op1.vr = SRToVR[p->op1.sr];
+                rename_use(&p->op1, SRToVR, &VRName, &live);
+                rename_use(&p->op3, SRToVR, &VRName, &live);
                 p->op1.nu = LU[p->op1.sr];
-                LU[p->op1.sr] = index;
-
-                // use r3
-                if (SRToVR[p->op3.sr] == -1) SRToVR[p->op3.sr] = VRName++;
-                p->op3.vr = SRToVR[p->op3.sr];
                 p->op3.nu = LU[p->op3.sr];
+                LU[p->op1.sr] = index;
                 LU[p->op3.sr] = index;
                 break;
             default:
                 break;
         }
+        if (live > live_at[index]) live_at[index] = live;
+        if (live_at[index] > max_live) max_live = live_at[index];
         index--;
     }
+
+    vr_count = VRName;
+
+    free(SRToVR);
+    free(LU);
 }
 
 void ir_rename_print(void) {
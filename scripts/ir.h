@@ -27,10 +27,18 @@ typedef struct IRNode {
     int line; // source line number
     IROpcode opcode; // operation type
     IROperand op1, op2, op3; // up to 3 operands
+    int addr; // memory address of load, store or output; -1 if unknown
+    int bundled; // issues in the same cycle as prev (ir_bundle)
     struct IRNode *prev;
     struct IRNode *next;
 } IRNode;
 
+// filled in by ir_rename
+extern int vr_count;  // number of VRs
+extern int max_live;  // most VRs live across any operation
+extern int block_len;  // number of operations
+extern int *live_at;   // VRs needing a register at each operation, by index
+
 // init functions
 void init_pool_list();
 void init_node_list();
@@ -38,6 +46,12 @@ void init_node_list();
 // builder function for each ir code
 IRNode *ir_build(IROpcode op, int line, int nops, ...);
 
+// node list access, used by the allocator
+IRNode *ir_head(void);
+IRNode *ir_insert_before(IRNode *pos, IROpcode op, int line);
+void remove_from_node_list(struct IRNode *n);
+void ir_reset_nodes(void);
+
 // print function
 void ir_print(void);
 
@@ -1,39 +1,177 @@
+#include <ctype.h>
+#include <fcntl.h>
 #include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
+#include "alloc.h"
+#include "cache.h"
+#include "diag.h"
 #include "error.h"
 #include "ir.h"
+#include "opt.h"
+#include "oracle.h"
 #include "parser.h"
+#include "perf.h"
+#include "pressure.h"
 #include "scanner.h"
+#include "sched.h"
+#include "stalls.h"
+#include "stream.h"
+#include "sweep.h"
+#include "verify.h"
 
 int error_flag = 0;
 
 static void print_usage() {
     printf("COMP 412, Reference Allocator (lab 2)\n");
     printf("Command Syntax:\n");
-    printf("    412alloc k filename [-x] [-h]\n\n");
+    printf("    412alloc k filename [-O] [-s] [-x] [-h] [--verify] [--cache dir]\n");
+    printf("    412alloc k filename --stall-profile file [-O] [--verify] [--cache dir]\n");
+    printf("    412alloc k filename --bundle [-O] [--verify] [--cache dir]\n");
+    printf("    412alloc k filename --stream\n");
+    printf("    412alloc --k-range lo-hi [--jobs n] filename [-O] [-s] [--cache dir]\n");
+    printf("    412alloc k filename --pressure[=n] [-O] [--cache dir]\n");
+    printf("    412alloc k filename --oracle[=seconds] [-O] [--cache dir]\n\n");
 
     printf("Required arguments:\n");
-    printf("    filename  is the pathname (absolute or relative) to the input file\n\n");
+    printf("    k         is the number of registers available to the allocator (3 <= k <= 64)\n");
+    printf("    filename  is the pathname (absolute or relative) to the input file,\n");
+    printf("              or - to read standard input\n\n");
 
     printf("Optional flags:\n");
     printf("\t-h\t prints this message\n");
+    printf("\t-O\t folds constants and removes unused definitions before allocation\n");
+    printf("\t-s\t schedules the allocated code to hide load/store latency\n");
     printf("\t-x\t runs renamer and prints renamed IR code\n");
+    printf("\t--bundle schedules the allocated code for the lab 3 machine, two\n");
+    printf("\t\t operations per cycle as [ op ; op ] (simulator/src: make sim3)\n");
+    printf("\t--verify runs the input and the allocated block and compares outputs,\n");
+    printf("\t\t final memory and cycle counts (report on stderr)\n");
+    printf("\t--cache dir keeps the renamed IR of each input in dir, so later runs\n");
+    printf("\t\t on the same file skip scanning, parsing and renaming\n");
+    printf("\t--stream allocates blocks too large for memory: parses the input\n");
+    printf("\t\t into a temporary file ($TMPDIR or /tmp), then renames and\n");
+    printf("\t\t allocates it a window at a time\n");
+    printf("\t--k-range lo-hi allocates for every k from lo to hi after one parse and\n");
+    printf("\t\t rename, writing <name>.k<k>.i for each k and a table of spills,\n");
+    printf("\t\t restores and estimated cycles to stdout\n");
+    printf("\t--jobs n  runs up to n values of k at once with --k-range (default 1)\n");
+    printf("\t--pressure[=n] prints the live count at each operation, the n regions\n");
+    printf("\t\t (default %d) with the most values live beyond k, and a histogram,\n",
+           PRESSURE_TOP);
+    printf("\t\t instead of allocating\n");
+    printf("\t--oracle[=seconds] searches for the fewest spills, restores and remats\n");
+    printf("\t\t that allocate a block of up to %d operations at k and prints\n",
+           ORACLE_MAX_OPS);
+    printf("\t\t them next to the allocator's, instead of allocating (default\n");
+    printf("\t\t time limit %d s)\n", ORACLE_SECONDS);
+    printf("\t--stall-profile file reads the stalls the simulator recorded (sim -p)\n");
+    printf("\t\t for the plain allocation of this block at k and avoids evicting\n");
+    printf("\t\t values next used by the operations that stalled\n");
 }
 
 int main(int argc, char* argv[]) {
     int opt;
-    int hflag = 0, xflag = 0;
+    int hflag = 0, oflag = 0, sflag = 0, xflag = 0, vflag = 0, stream = 0, bundle = 0;
+    int k_lo = 0, k_hi = 0, jobs = 1, pressure = 0;
+    double oracle = 0;
+    const char* cache_dir = NULL;
+    const char* stall_file = NULL;
+    char* end;
+    long lo, hi;
+
+    static struct option long_options[] = {
+        {"verify", no_argument, NULL, 'V'},
+        {"cache", required_argument, NULL, 'C'},
+        {"stream", no_argument, NULL, 'S'},
+        {"k-range", required_argument, NULL, 'K'},
+        {"jobs", required_argument, NULL, 'j'},
+        {"pressure", optional_argument, NULL, 'P'},
+        {"stall-profile", required_argument, NULL, 'F'},
+        {"oracle", optional_argument, NULL, 'Q'},
+        {"bundle", no_argument, NULL, 'B'},
+        {NULL, 0, NULL, 0},
+    };
 
     opterr = 0;
 
-    while ((opt = getopt(argc, argv, "hx")) != -1) {
+    while ((opt = getopt_long(argc, argv, "hOsx", long_options, NULL)) != -1) {
         switch (opt) {
+            case 'V':
+                vflag = 1;
+                break;
+            case 'C':
+                cache_dir = optarg;
+                break;
+            case 'S':
+                stream = 1;
+                break;
+            case 'K':
+                // digits, '-', digits and nothing else; strtol alone would
+                // also take leading blanks and signs
+                lo = hi = 0;
+                if (isdigit((unsigned char)optarg[0])) {
+                    lo = strtol(optarg, &end, 10);
+                    if (*end == '-' && isdigit((unsigned char)end[1])) {
+                        hi = strtol(end + 1, &end, 10);
+                        if (*end != '\0') hi = 0;
+                    }
+                }
+                if (lo < 3 || hi > 64 || lo > hi) {
+                    fprintf(stderr, "ERROR: --k-range takes lo-hi with 3 <= lo <= hi <= 64, "
+                                    "got '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                k_lo = (int)lo;
+                k_hi = (int)hi;
+                break;
+            case 'j':
+                jobs = (int)strtol(optarg, &end, 10);
+                if (*end != '\0' || jobs < 1) {
+                    fprintf(stderr, "ERROR: --jobs takes a positive integer, got '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'P':
+                pressure = PRESSURE_TOP;
+                if (optarg) {
+                    pressure = (int)strtol(optarg, &end, 10);
+                    if (*end != '\0' || pressure < 1) {
+                        fprintf(stderr, "ERROR: --pressure takes a positive count, got '%s'\n",
+                                optarg);
+                        return EXIT_FAILURE;
+                    }
+                }
+                break;
+            case 'F':
+                stall_file = optarg;
+                break;
+            case 'Q':
+                oracle = ORACLE_SECONDS;
+                if (optarg) {
+                    oracle = strtod(optarg, &end);
+                    if (*end != '\0' || oracle <= 0) {
+                        fprintf(stderr, "ERROR: --oracle takes a positive number of seconds, "
+                                        "got '%s'\n", optarg);
+                        return EXIT_FAILURE;
+                    }
+                }
+                break;
+            case 'B':
+                bundle = 1;
+                break;
             case 'h':
                 hflag = 1;
                 break;
+            case 'O':
+                oflag = 1;
+                break;
+            case 's':
+                sflag = 1;
+                break;
             case 'x':
                 xflag = 1;
                 break;
@@ -49,12 +187,78 @@ int main(int argc, char* argv[]) {
         return EXIT_SUCCESS;
     }
 
-    if (!xflag) {
-        fprintf(stderr, "ERROR: Missing required -x flag\n");
+    if (vflag && xflag) {
+        fprintf(stderr, "ERROR: --verify checks an allocation and cannot be used with -x\n");
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    if (stream && (oflag || sflag || xflag || vflag || cache_dir)) {
+        fprintf(stderr, "ERROR: --stream never holds the whole block and cannot be used with "
+                        "-O, -s, -x, --verify or --cache\n");
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    if (k_lo && (xflag || vflag || stream)) {
+        fprintf(stderr, "ERROR: --k-range writes one file per k and cannot be used with "
+                        "-x, --verify or --stream\n");
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    if (jobs != 1 && !k_lo) {
+        fprintf(stderr, "ERROR: --jobs needs --k-range\n");
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    if (pressure && (xflag || sflag || vflag || stream || k_lo)) {
+        fprintf(stderr, "ERROR: --pressure reports instead of allocating and cannot be used with "
+                        "-x, -s, --verify, --stream or --k-range\n");
         print_usage();
         return EXIT_FAILURE;
     }
 
+    if (oracle && (xflag || sflag || vflag || stream || k_lo || pressure || stall_file)) {
+        fprintf(stderr, "ERROR: --oracle reports instead of allocating and cannot be used with "
+                        "-x, -s, --verify, --stream, --k-range, --pressure or --stall-profile\n");
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    if (stall_file && (xflag || sflag || stream || k_lo || pressure)) {
+        fprintf(stderr, "ERROR: --stall-profile maps the lines of a plain allocation and cannot "
+                        "be used with -x, -s, --stream, --k-range or --pressure\n");
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    if (bundle && (sflag || xflag || stream || k_lo || pressure || oracle || stall_file)) {
+        fprintf(stderr, "ERROR: --bundle schedules for the lab 3 machine and cannot be used with "
+                        "-s, -x, --stream, --k-range, --pressure, --oracle or --stall-profile\n");
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    // without -x or --k-range, the first argument is k
+    int k = 0;
+    if (!xflag && !k_lo) {
+        if (optind >= argc) {
+            fprintf(stderr, "ERROR: Missing k\n");
+            print_usage();
+            return EXIT_FAILURE;
+        }
+        k = (int)strtol(argv[optind], &end, 10);
+        if (*end != '\0' || k < 3 || k > 64) {
+            fprintf(stderr, "ERROR: k must be an integer between 3 and 64, got '%s'\n",
+                    argv[optind]);
+            print_usage();
+            return EXIT_FAILURE;
+        }
+        optind++;
+    }
+
     if (optind >= argc) {
         fprintf(stderr, "ERROR: Missing filename\n");
         print_usage();
@@ -62,28 +266,115 @@ int main(int argc, char* argv[]) {
     }
 
     const char* filename = argv[optind];
-    FILE* f_in = fopen(filename, "r");
-    if (!f_in) {
+    int from_stdin = strcmp(filename, "-") == 0;
+    if (from_stdin && (stream || vflag || cache_dir)) {
+        fprintf(stderr, "ERROR: --stream, --verify and --cache read the input file again "
+                        "and need a filename, not -\n");
+        return EXIT_FAILURE;
+    }
+
+    if (stream) {
+        init_pool_list();
+        init_node_list();
+        if (stream_allocate(filename, k) == 0) return EXIT_SUCCESS;
+        if (!error_flag) return EXIT_FAILURE;
+        diag_flush();
+        fprintf(stderr, "\nDue to syntax error(s), run terminates.\n");
+        return EXIT_SUCCESS;
+    }
+
+    int fd = from_stdin ? STDIN_FILENO : open(filename, O_RDONLY);
+    if (fd < 0) {
         fprintf(stderr, "ERROR: Could not open file '%s'\n", filename);
         return EXIT_FAILURE;
     }
 
-    // initialize scanner, IR pools
-    sb_init(f_in);
+    // initialize IR pools
     init_pool_list();
     init_node_list();
 
-    int count = 0;
-    parse_program(&count);
+    // a cached block is already parsed and renamed
+    int cached = cache_dir && ir_cache_load(cache_dir, filename);
+    if (!cached) {
+        if (!from_stdin) perf_scan(fd);
+        perf_begin("parse");
+        sb_init(fd);
+        int count = 0;
+        parse_program(&count);
+        sb_free();
+        perf_end();
+    }
 
+    int status = EXIT_SUCCESS;
     if (!error_flag) {
-        ir_rename();
-        ir_rename_print();
+        if (vflag) verify_capture();
+        if (!cached) {
+            perf_begin("rename");
+            ir_rename();
+            perf_end();
+            if (cache_dir) ir_cache_save(cache_dir, filename);
+        }
+        if (oflag) {
+            perf_begin("optimize");
+            ir_optimize();
+            perf_end();
+            fprintf(stderr, "Optimizer: folded %d operations, removed %d operations and %d VRs\n",
+                    opt_stats.folded, opt_stats.removed, opt_stats.vrs_removed);
+        }
+        if (xflag) {
+            ir_rename_print();
+        } else if (pressure) {
+            ir_pressure_report(k, pressure);
+        } else if (oracle) {
+            ir_oracle_report(k, oracle);
+        } else if (k_lo) {
+            if (sweep_allocate(filename, k_lo, k_hi, jobs, sflag) != 0) status = EXIT_FAILURE;
+        } else if (stall_file && stalls_load(stall_file, k) != 0) {
+            status = EXIT_FAILURE;
+        } else {
+            if (sflag || bundle || vflag) {
+                // the scheduler and the checker work on the allocated IR
+                if (sflag || bundle) ir_find_addresses();
+                perf_begin("allocate");
+                ir_allocate(k);
+                perf_end();
+                if (sflag || bundle) {
+                    perf_begin("schedule");
+                    if (bundle)
+                        ir_bundle();
+                    else
+                        ir_schedule();
+                    perf_end();
+                }
+                perf_begin("emit");
+                ir_alloc_print();
+                perf_end();
+            } else {
+                perf_begin("allocate+emit");
+                ir_allocate_emit(k);
+                perf_end();
+            }
+            if (vflag) {
+                if (verify_allocation(filename, k) == 0) {
+                    fprintf(stderr, "Verify: %d outputs and final memory match; "
+                            "%d cycles before allocation, %d after\n",
+                            verify_stats.outputs, verify_stats.orig_cycles,
+                            verify_stats.alloc_cycles);
+                    fprintf(stderr, "Verify: %d restores, %d hoisted ahead of their use, "
+                            "%d of those fully latency-hidden\n",
+                            alloc_stats.restores, alloc_stats.hoisted, alloc_stats.hidden);
+                } else {
+                    fprintf(stderr, "Verify: allocation FAILED\n");
+                    status = EXIT_FAILURE;
+                }
+            }
+        }
     } else {
+        diag_flush();
         fprintf(stderr, "\nDue to syntax error(s), run terminates.\n");
     }
 
-    sb_free();
-    fclose(f_in);
-    return EXIT_SUCCESS;
+    perf_report();
+    if (!from_stdin) close(fd);
+    return status;
 }
@@ -0,0 +1,174 @@
+#include "opt.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ir.h"
+
+// evaluate an arithmetic op the way the simulator does (32-bit ints);
+// returns 0 when the result is not well defined
+static int fold(IROpcode op, int a, int b, int *out) {
+    switch (op) {
+        case IR_ADD:
+            *out = (int)((unsigned)a + (unsigned)b);
+            return 1;
+        case IR_SUB:
+            *out = (int)((unsigned)a - (unsigned)b);
+            return 1;
+        case IR_MULT:
+            *out = (int)((unsigned)a * (unsigned)b);
+            return 1;
+        case IR_LSHIFT:
+            if (b < 0 || b > 31) return 0;
+            *out = (int)((unsigned)a << b);
+            return 1;
+        case IR_RSHIFT:
+            if (b < 0 || b > 31) return 0;
+            *out = a >> b;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// track the constant value of the VR defined by p, if it has one
+static void propagate(IRNode *p, int *VRVal, char *VRKnown) {
+    switch (p->opcode) {
+        case IR_LOADI:
+            VRVal[p->op3.vr] = p->op1.sr;
+            VRKnown[p->op3.vr] = 1;
+            break;
+
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MULT:
+        case IR_LSHIFT:
+        case IR_RSHIFT:
+            if (VRKnown[p->op1.vr] && VRKnown[p->op2.vr]) {
+                VRKnown[p->op3.vr] = fold(p->opcode, VRVal[p->op1.vr], VRVal[p->op2.vr],
+                                          &VRVal[p->op3.vr]);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void ir_find_addresses(void) {
+    IRNode *head = ir_head();
+    int nvr = vr_count > 0 ? vr_count : 1;
+
+    // every VR has a single definition after renaming, so one forward
+    // walk sees each constant before any of its uses
+    int *VRVal = malloc(nvr * sizeof(int));
+    char *VRKnown = calloc(nvr, sizeof(char));
+
+    for (IRNode *p = head->next; p != head; p = p->next) {
+        switch (p->opcode) {
+            case IR_LOAD:
+                if (VRKnown[p->op1.vr] && VRVal[p->op1.vr] >= 0) p->addr = VRVal[p->op1.vr];
+                break;
+
+            case IR_STORE:
+                if (VRKnown[p->op3.vr] && VRVal[p->op3.vr] >= 0) p->addr = VRVal[p->op3.vr];
+                break;
+
+            case IR_OUTPUT:
+                p->addr = p->op1.sr;
+                break;
+
+            default:
+                propagate(p, VRVal, VRKnown);
+                break;
+        }
+    }
+
+    free(VRVal);
+    free(VRKnown);
+}
+
+OptStats opt_stats;
+
+static inline int is_arith(IROpcode op) {
+    return op == IR_ADD || op == IR_SUB || op == IR_MULT || op == IR_LSHIFT || op == IR_RSHIFT;
+}
+
+void ir_optimize(void) {
+    IRNode *head = ir_head();
+    int nvr = vr_count > 0 ? vr_count : 1;
+    int *VRVal = malloc(nvr * sizeof(int));
+    char *VRKnown = calloc(nvr, sizeof(char));
+    int *uses = calloc(nvr, sizeof(int));
+    int old_vrs = vr_count;
+
+    // fold arithmetic on constants into loadI
+    for (IRNode *p = head->next; p != head; p = p->next) {
+        propagate(p, VRVal, VRKnown);
+
+        // the scanner only reads non-negative constants, keep it that way
+        if (is_arith(p->opcode) && VRKnown[p->op3.vr] && VRVal[p->op3.vr] >= 0) {
+            p->opcode = IR_LOADI;
+            memset(&p->op1, -1, 2 * sizeof(IROperand));
+            p->op1.sr = VRVal[p->op3.vr];
+            opt_stats.folded++;
+        }
+    }
+
+    for (IRNode *p = head->next; p != head; p = p->next) {
+        switch (p->opcode) {
+            case IR_LOAD:
+                uses[p->op1.vr]++;
+                break;
+            case IR_STORE:
+                uses[p->op1.vr]++;
+                uses[p->op3.vr]++;
+                break;
+            default:
+                if (is_arith(p->opcode)) {
+                    uses[p->op1.vr]++;
+                    uses[p->op2.vr]++;
+                }
+                break;
+        }
+    }
+
+    // delete definitions nobody reads; walking backward means every use
+    // of a VR has been seen (and maybe deleted) before its definition
+    IRNode *p = head->prev;
+    while (p != head) {
+        IRNode *prev = p->prev;
+        int dead = 0;
+
+        switch (p->opcode) {
+            case IR_LOADI:
+                dead = uses[p->op3.vr] == 0;
+                break;
+            case IR_LOAD:
+                dead = uses[p->op3.vr] == 0;
+                if (dead) uses[p->op1.vr]--;
+                break;
+            default:
+                if (is_arith(p->opcode) && uses[p->op3.vr] == 0) {
+                    dead = 1;
+                    uses[p->op1.vr]--;
+                    uses[p->op2.vr]--;
+                }
+                break;
+        }
+
+        if (dead) {
+            remove_from_node_list(p);
+            opt_stats.removed++;
+        }
+        p = prev;
+    }
+
+    free(VRVal);
+    free(VRKnown);
+    free(uses);
+
+    // names and next uses are stale after deleting operations
+    ir_rename();
+    opt_stats.vrs_removed = old_vrs - vr_count;
+}
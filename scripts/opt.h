@@ -0,0 +1,20 @@
+#ifndef OPT_H
+#define OPT_H
+
+// propagate loadI constants through the renamed IR and record the
+// address of every load, store and output whose address is known
+void ir_find_addresses(void);
+
+typedef struct {
+    int folded;       // arithmetic ops turned into loadI
+    int removed;      // operations deleted because their result is never used
+    int vrs_removed;  // drop in VR count after renaming again
+} OptStats;
+
+extern OptStats opt_stats;
+
+// fold constant arithmetic into loadI, delete unused definitions, and
+// rename the block again
+void ir_optimize(void);
+
+#endif
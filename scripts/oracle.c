@@ -0,0 +1,352 @@
+#include "oracle.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "alloc.h"
+#include "ir.h"
+
+// states remembered with the cheapest cost seen at them; a lossy table,
+// a new state simply replaces whatever hashed to its entry
+#define MEMO_BITS 20
+#define CLOCK_EVERY 16384  // states between time limit checks
+
+typedef struct {
+    int use[2], use_nu[2];  // distinct VRs read and their next uses after this op
+    int nuses;
+    int def, def_nu;  // VR written, -1 if none
+} Op;
+
+// the values held in PRs at one point of the search; slots are unordered
+typedef struct {
+    int vr[MAX_K];
+    int nu[MAX_K];
+    uint64_t dirty;  // bit slot set when the value is not in memory
+    int n;
+    uint64_t key;  // hash of the values held and which of them are dirty
+    int spills, restores, remats;
+    int owed;  // the cheapest reload of every evicted value needed again
+} State;
+
+typedef struct {
+    uint64_t key;
+    int cost;
+} Memo;
+
+static Op *ops;
+static int nops;
+static int regs;
+static char *is_const;
+static char *fresh;  // used before any definition and not yet in a PR; loads for free
+static Memo *memo;
+static OracleResult best;
+static int best_cost;
+static clock_t deadline;
+static int stopped;
+
+static uint64_t mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static inline uint64_t z_held(int vr) {
+    return mix(2 * (uint64_t)vr);
+}
+
+static inline uint64_t z_dirty(int vr) {
+    return mix(2 * (uint64_t)vr + 1);
+}
+
+static inline int cost_of(const State *s) {
+    return ORACLE_MEM_COST * (s->spills + s->restores) + ORACLE_REMAT_COST * s->remats;
+}
+
+static int find(const State *s, int vr) {
+    for (int i = 0; i < s->n; i++) {
+        if (s->vr[i] == vr) return i;
+    }
+    return -1;
+}
+
+static void hold(State *s, int vr, int nu, int dirty) {
+    int i = s->n++;
+    s->vr[i] = vr;
+    s->nu[i] = nu;
+    s->key ^= z_held(vr);
+    if (dirty) {
+        s->dirty |= (uint64_t)1 << i;
+        s->key ^= z_dirty(vr);
+    } else {
+        s->dirty &= ~((uint64_t)1 << i);
+    }
+}
+
+// drop slot i; the last slot moves into it
+static void drop(State *s, int i) {
+    int last = --s->n;
+    s->key ^= z_held(s->vr[i]);
+    if (s->dirty >> i & 1) s->key ^= z_dirty(s->vr[i]);
+    s->vr[i] = s->vr[last];
+    s->nu[i] = s->nu[last];
+    s->dirty &= ~((uint64_t)1 << i);
+    if (s->dirty >> last & 1) s->dirty |= (uint64_t)1 << i;
+    s->dirty &= ~((uint64_t)1 << last);
+}
+
+static inline int reload_cost(int vr) {
+    return is_const[vr] ? ORACLE_REMAT_COST : ORACLE_MEM_COST;
+}
+
+static void evict(State *s, int i) {
+    if (s->dirty >> i & 1) s->spills++;
+    if (s->nu[i] != INT_MAX) s->owed += reload_cost(s->vr[i]);
+    drop(s, i);
+}
+
+static inline int marked(const Op *o, int vr, int stage) {
+    return stage < o->nuses && (o->use[0] == vr || (o->nuses > 1 && o->use[1] == vr));
+}
+
+// the unmarked slots, furthest next use first so the first allocation
+// found is the heuristic's and later branches only have to beat it.
+// Every victim is tried: with store costs and rematerialization, evicting
+// the furthest clean or dirty value is not always optimal
+static int candidates(const State *s, const Op *o, int stage, int *order) {
+    int n = 0;
+    for (int i = 0; i < s->n; i++) {
+        if (marked(o, s->vr[i], stage)) continue;
+        int j = n++;
+        while (j > 0 && s->nu[order[j - 1]] < s->nu[i]) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+    return n;
+}
+
+static void boundary(int i, State *s);
+
+// satisfy demand stage of op i: its uses in turn, then its definition
+static void step(int i, int stage, State *s) {
+    const Op *o = &ops[i];
+
+    if (stage < o->nuses) {
+        int vr = o->use[stage];
+        int at = find(s, vr);
+        if (at >= 0) {
+            s->nu[at] = o->use_nu[stage];
+            step(i, stage + 1, s);
+            return;
+        }
+
+        int was_fresh = fresh[vr];
+        State t = *s;
+        if (was_fresh) {
+            fresh[vr] = 0;
+        } else {
+            t.owed -= reload_cost(vr);
+            if (is_const[vr])
+                t.remats++;
+            else
+                t.restores++;
+        }
+
+        if (t.n < regs) {
+            hold(&t, vr, o->use_nu[stage], was_fresh);
+            step(i, stage + 1, &t);
+        } else {
+            int order[MAX_K];
+            int n = candidates(&t, o, stage, order);
+            for (int j = 0; j < n && !stopped; j++) {
+                State u = t;
+                evict(&u, order[j]);
+                hold(&u, vr, o->use_nu[stage], was_fresh);
+                step(i, stage + 1, &u);
+            }
+        }
+        fresh[vr] = was_fresh;
+        return;
+    }
+
+    // values read for the last time give up their PRs before the definition
+    State t = *s;
+    for (int u = 0; u < o->nuses; u++) {
+        if (o->use_nu[u] != INT_MAX) continue;
+        int at = find(&t, o->use[u]);
+        if (at >= 0) drop(&t, at);
+    }
+
+    if (o->def == -1) {
+        boundary(i + 1, &t);
+        return;
+    }
+
+    int konst = is_const[o->def];
+    if (t.n < regs) {
+        hold(&t, o->def, o->def_nu, !konst);
+        if (o->def_nu == INT_MAX) drop(&t, t.n - 1);
+        boundary(i + 1, &t);
+        return;
+    }
+
+    // a constant can also stay out of the PRs from its definition on,
+    // tried in its place in the order
+    int order[MAX_K + 1];
+    int n = candidates(&t, o, stage, order);
+    if (konst) {
+        int j = n++;
+        while (j > 0 && t.nu[order[j - 1]] < o->def_nu) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = -1;
+    }
+
+    for (int j = 0; j < n && !stopped; j++) {
+        State u = t;
+        if (order[j] == -1) {
+            if (o->def_nu != INT_MAX) u.owed += ORACLE_REMAT_COST;
+        } else {
+            evict(&u, order[j]);
+            hold(&u, o->def, o->def_nu, !konst);
+            if (o->def_nu == INT_MAX) drop(&u, u.n - 1);
+        }
+        boundary(i + 1, &u);
+    }
+}
+
+// the state before op i
+static void boundary(int i, State *s) {
+    int cost = cost_of(s);
+    // every evicted value still needed costs at least one more reload
+    if (cost + s->owed >= best_cost) return;
+
+    if (i == nops) {
+        best_cost = cost;
+        best.spills = s->spills;
+        best.restores = s->restores;
+        best.remats = s->remats;
+        best.cost = cost;
+        return;
+    }
+
+    if (++best.nodes % CLOCK_EVERY == 0 && clock() > deadline) {
+        stopped = 1;
+        return;
+    }
+
+    uint64_t key = s->key ^ mix(~(uint64_t)i);
+    Memo *m = &memo[key & ((1 << MEMO_BITS) - 1)];
+    if (m->key == key && m->cost <= cost) return;
+    m->key = key;
+    m->cost = cost;
+
+    step(i, 0, s);
+}
+
+static inline int is_arith(IROpcode op) {
+    return op == IR_ADD || op == IR_SUB || op == IR_MULT || op == IR_LSHIFT || op == IR_RSHIFT;
+}
+
+static void add_use(Op *o, IROperand *op) {
+    if (o->nuses == 1 && o->use[0] == op->vr) return;
+    o->use[o->nuses] = op->vr;
+    o->use_nu[o->nuses] = op->nu;
+    o->nuses++;
+}
+
+int ir_oracle(int k, int bound, double seconds, OracleResult *result) {
+    if (block_len > ORACLE_MAX_OPS) return -1;
+
+    IRNode *head = ir_head();
+    int nvr = vr_count > 0 ? vr_count : 1;
+    nops = block_len;
+    regs = max_live > k ? k - 1 : k;
+    ops = calloc(nops > 0 ? nops : 1, sizeof(Op));
+    is_const = calloc(nvr, 1);
+    fresh = malloc(nvr);
+    memset(fresh, 1, nvr);
+
+    int index = 0;
+    for (IRNode *p = head->next; p != head; p = p->next, index++) {
+        Op *o = &ops[index];
+        o->def = -1;
+        switch (p->opcode) {
+            case IR_LOAD:
+                add_use(o, &p->op1);
+                break;
+            case IR_STORE:
+                add_use(o, &p->op1);
+                add_use(o, &p->op3);
+                break;
+            default:
+                if (is_arith(p->opcode)) {
+                    add_use(o, &p->op1);
+                    add_use(o, &p->op2);
+                }
+                break;
+        }
+        if (p->opcode == IR_LOAD || p->opcode == IR_LOADI || is_arith(p->opcode)) {
+            o->def = p->op3.vr;
+            o->def_nu = p->op3.nu;
+            is_const[o->def] = p->opcode == IR_LOADI;
+            fresh[o->def] = 0;
+        }
+    }
+
+    memo = calloc(1 << MEMO_BITS, sizeof(Memo));
+    memset(&best, 0, sizeof best);
+    best.cost = -1;
+    best_cost = bound + 1;
+    stopped = 0;
+    deadline = clock() + (clock_t)(seconds * CLOCKS_PER_SEC);
+
+    State s;
+    memset(&s, 0, sizeof s);
+    boundary(0, &s);
+
+    best.proved = !stopped;
+    *result = best;
+
+    free(memo);
+    free(ops);
+    free(is_const);
+    free(fresh);
+    return 0;
+}
+
+void ir_oracle_report(int k, double seconds) {
+    int lines;
+    memset(&alloc_stats, 0, sizeof alloc_stats);
+    free(alloc_replay(k, &lines));
+    AllocStats *h = &alloc_stats;
+    int heuristic = ORACLE_MEM_COST * (h->spills + h->restores) + ORACLE_REMAT_COST * h->remats;
+
+    OracleResult r;
+    if (ir_oracle(k, heuristic, seconds, &r) != 0) {
+        printf("Oracle: %d operations, more than the %d it searches\n", block_len, ORACLE_MAX_OPS);
+        return;
+    }
+
+    printf("Oracle: k = %d, %d operations, %d VRs, max live %d, %d PRs for values\n", k,
+           block_len, vr_count, max_live, max_live > k ? k - 1 : k);
+    printf("  cost = %d x (spills + restores) + %d x remats\n", ORACLE_MEM_COST, ORACLE_REMAT_COST);
+    printf("  heuristic: %6d from %d spills, %d restores, %d remats\n", heuristic, h->spills,
+           h->restores, h->remats);
+    if (r.cost < 0) {
+        printf("  optimal:   nothing cheaper found in %.0f s (%ld states)\n", seconds, r.nodes);
+        return;
+    }
+    printf("  %-10s %6d from %d spills, %d restores, %d remats\n",
+           r.proved ? "optimal:" : "best found:", r.cost, r.spills, r.restores, r.remats);
+    printf("  gap: %d (%.1f%%), %s after %ld states\n", heuristic - r.cost,
+           r.cost > 0 ? 100.0 * (heuristic - r.cost) / r.cost : 0.0,
+           r.proved ? "proved" : "time limit reached", r.nodes);
+}
@@ -0,0 +1,38 @@
+#ifndef ORACLE_H
+#define ORACLE_H
+
+// blocks longer than this are refused; the search is exponential
+#define ORACLE_MAX_OPS 500
+
+// default time limit for --oracle, in seconds
+#define ORACLE_SECONDS 10
+
+// the cost of spill code is the operations it adds: a store or a restore
+// also needs its slot address in a register, a remat is one loadI
+#define ORACLE_MEM_COST 2
+#define ORACLE_REMAT_COST 1
+
+typedef struct {
+    int spills;    // stores of values evicted before they were in memory
+    int restores;  // loads of evicted values
+    int remats;    // loadI of evicted constants
+    int cost;      // weighted by ORACLE_MEM_COST and ORACLE_REMAT_COST
+    int proved;    // 0 when the time limit cut the search short
+    long nodes;    // search states visited
+} OracleResult;
+
+// find the cheapest spill code (stores, restores and rematerializing
+// loadIs, weighted as above) that allocates the renamed IR onto the PRs
+// the allocator would use at k, by branch and bound over eviction
+// choices. Address loads the allocator shares between spill operations
+// are not modelled, so both sides are costed as if none were. The search
+// starts with the heuristic's cost as its bound and stops after seconds;
+// result is the best allocation found, with proved set when it is
+// optimal.
+// Returns -1 if the block is longer than ORACLE_MAX_OPS
+int ir_oracle(int k, int bound, double seconds, OracleResult *result);
+
+// print the heuristic's spill cost at k next to the oracle's (stdout)
+void ir_oracle_report(int k, double seconds);
+
+#endif
@@ -0,0 +1,36 @@
+#!/bin/bash
+# usage: oracle.sh "blocks" "ks" seconds
+# the allocator's spill cost (stores + restores + remats) against the
+# oracle's for every block and k; the oracle stops after seconds
+blocks=$1
+ks=$2
+secs=$3
+
+printf "%-14s %4s %6s %10s %10s %8s  %s\n" "block" "k" "ops" "heuristic" "optimal" "gap" "search"
+total_h=0
+total_o=0
+for f in $blocks; do
+    for k in $ks; do
+        out=$(./412alloc --oracle="$secs" "$k" "$f")
+        ops=$(echo "$out" | awk '/^Oracle: k/ { print $5 }')
+        h=$(echo "$out" | awk '/heuristic:/ { print $2 }')
+        o=$(echo "$out" | awk '/optimal:|best found:/ { print $(NF - 7) }')
+        if [ -z "$h" ]; then
+            printf "%-14s %4d %s\n" "$(basename "$f")" "$k" "$(echo "$out" | head -1)"
+            continue
+        fi
+        if [ -z "$o" ]; then
+            printf "%-14s %4d %6d %10d %10s %8s  %s\n" "$(basename "$f")" "$k" "$ops" "$h" "-" "-" \
+                "nothing cheaper in ${secs}s"
+            continue
+        fi
+        if echo "$out" | grep -q proved; then status=proved; else status="best in ${secs}s"; fi
+        gap=$(awk -v h="$h" -v o="$o" 'BEGIN { printf "%.1f%%", o ? 100 * (h - o) / o : 0 }')
+        printf "%-14s %4d %6d %10d %10d %8s  %s\n" "$(basename "$f")" "$k" "$ops" "$h" "$o" "$gap" \
+            "$status"
+        total_h=$((total_h + h))
+        total_o=$((total_o + o))
+    done
+done
+printf "%-14s %4s %6s %10d %10d %8s\n" "total" "" "" "$total_h" "$total_o" \
+    "$(awk -v h=$total_h -v o=$total_o 'BEGIN { printf "%.1f%%", o ? 100 * (h - o) / o : 0 }')"
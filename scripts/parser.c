@@ -1,24 +1,17 @@
 #include "parser.h"
 
-#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 
-#include "error.h"
+#include "diag.h"
 #include "ir.h"
 
 static Token word;
 static int opCount;
 static Token tb[3];
 
-static void parse_errorf(int line, const char *fmt, ...) {
-    va_list args;
-    va_start(args, fmt);
-    fprintf(stderr, "ERROR %d:\t", line);
-    vfprintf(stderr, fmt, args);
-    fprintf(stderr, "\n");
-    va_end(args);
-    error_flag = 1;
+static void parse_errorf(int line, DiagCode code, const char *arg) {
+    diag_error(line, code, arg, -1);
 
     // get next token until this line is flushed
     while (word.type != TOK_EOL && word.type != TOK_EOF) {
@@ -98,14 +91,13 @@ const char *token_to_string(Token tok) {
     return buf;
 }
 
-void parse_program(int *count) {
-    opCount = 0;
-
-    word = get_next_token();
-    int line;
+int parse_next(void) {
+    for (;;) {
+        word = get_next_token();
+        if (word.type == TOK_EOF) return 0;
 
-    while (word.type != TOK_EOF) {
-        line = word.line;
+        int line = word.line;
+        int before = opCount;
         switch (word.type) {
             case TOK_MEMOP:
                 finish_memop(word, line);
@@ -126,41 +118,45 @@ void parse_program(int *count) {
                 break;
             default:
                 printf("Unexpected token type %d at line %d\n", word.type, line);
-                parse_errorf(line, "unexpected df token at line");
+                parse_errorf(line, D_UNEXPECTED, NULL);
         }
         // parse error may already skip to the next one
+        if (opCount > before) return 1;
+    }
+}
 
-        word = get_next_token();
+void parse_program(int *count) {
+    opCount = 0;
+    while (parse_next()) {
     }
     *count = opCount;
-    return;
 }
 
 void finish_memop(Token first, int line) {
     word = get_next_token();
 
     if (word.type != TOK_REG) {
-        parse_errorf(line, "Missing source register in load or store.");
+        parse_errorf(line, D_MEM_SRC, NULL);
         return;
     };
     tb[0] = word;
 
     word = get_next_token();
     if (word.type != TOK_INTO) {
-        parse_errorf(line, "Missing '=>' in load or store.");
+        parse_errorf(line, D_MEM_INTO, NULL);
         return;
     }
 
     word = get_next_token();
     if (word.type != TOK_REG) {
-        parse_errorf(line, "Missing target register in load or store.");
+        parse_errorf(line, D_MEM_DST, NULL);
         return;
     }
     tb[1] = word;
 
     word = get_next_token();
     if (word.type != TOK_EOL && word.type != TOK_EOF) {
-        parse_errorf(line, "Extra token at end of line %s.", token_to_string(word));
+        parse_errorf(line, D_EXTRA, token_to_string(word));
         return;
     }
 
@@ -172,7 +168,7 @@ void finish_memop(Token first, int line) {
             ir_build(IR_STORE, line, 2, tb[0].value, tb[1].value);
             break;
         default:
-            parse_errorf(line, "Unknown memory operation.");
+            parse_errorf(line, D_MEM_OP, NULL);
             return;
     }
     opCount++;
@@ -182,27 +178,27 @@ void finish_loadI(int line) {
     word = get_next_token();
 
     if (word.type != TOK_CONST) {
-        parse_errorf(line, "Missing constant in loadI.");
+        parse_errorf(line, D_LOADI_CONST, NULL);
         return;
     }
     tb[0] = word;
 
     word = get_next_token();
     if (word.type != TOK_INTO) {
-        parse_errorf(line, "Missing '=>' in loadI.");
+        parse_errorf(line, D_LOADI_INTO, NULL);
         return;
     }
 
     word = get_next_token();
     if (word.type != TOK_REG) {
-        parse_errorf(line, "Missing target register in loadI.");
+        parse_errorf(line, D_LOADI_DST, NULL);
         return;
     }
     tb[1] = word;
 
     word = get_next_token();
     if (word.type != TOK_EOL && word.type != TOK_EOF) {
-        parse_errorf(line, "Extra token at end of line %s.", token_to_string(word));
+        parse_errorf(line, D_EXTRA, token_to_string(word));
         return;
     }
 
@@ -232,40 +228,40 @@ void finish_arithop(Token first, int line) {
     word = get_next_token();
     char *op = arithop_lexeme(first.value);
     if (word.type != TOK_REG) {
-        parse_errorf(line, "Missing first source register in %s.", op);
+        parse_errorf(line, D_ARITH_SRC1, op);
         return;
     }
     tb[0] = word;
 
     word = get_next_token();
     if (word.type != TOK_COMMA) {
-        parse_errorf(line, "Missing comma in %s.", op);
+        parse_errorf(line, D_ARITH_COMMA, op);
         return;
     }
 
     word = get_next_token();
     if (word.type != TOK_REG) {
-        parse_errorf(line, "Missing second source register in %s.", op);
+        parse_errorf(line, D_ARITH_SRC2, op);
         return;
     }
     tb[1] = word;
 
     word = get_next_token();
     if (word.type != TOK_INTO) {
-        parse_errorf(line, "Missing '=>' in %s", op);
+        parse_errorf(line, D_ARITH_INTO, op);
         return;
     }
 
     word = get_next_token();
     if (word.type != TOK_REG) {
-        parse_errorf(line, "Missing target register in %s.", op);
+        parse_errorf(line, D_ARITH_DST, op);
         return;
     }
     tb[2] = word;
 
     word = get_next_token();
     if (word.type != TOK_EOL && word.type != TOK_EOF) {
-        parse_errorf(line, "Extra token at end of line %s.", token_to_string(word));
+        parse_errorf(line, D_EXTRA, token_to_string(word));
         return;
     }
 
@@ -286,7 +282,7 @@ void finish_arithop(Token first, int line) {
             ir_build(IR_RSHIFT, line, 3, tb[0].value, tb[1].value, tb[2].value);
             break;
         default:
-            parse_errorf(line, "Unknown arithmetic op.");
+            parse_errorf(line, D_ARITH_OP, NULL);
             return;
     }
 
@@ -296,14 +292,14 @@ void finish_arithop(Token first, int line) {
 void finish_output(int line) {
     word = get_next_token();
     if (word.type != TOK_CONST) {
-        parse_errorf(line, "Missing constant in output.");
+        parse_errorf(line, D_OUTPUT_CONST, NULL);
         return;
     }
     tb[0] = word;
 
     word = get_next_token();
     if (word.type != TOK_EOL && word.type != TOK_EOF) {
-        parse_errorf(line, "Extra token at end of line %s.", token_to_string(word));
+        parse_errorf(line, D_EXTRA, token_to_string(word));
         return;
     }
 
@@ -314,7 +310,7 @@ void finish_output(int line) {
 void finish_nop(int line) {
     Token word = get_next_token();
     if (word.type != TOK_EOL && word.type != TOK_EOF) {
-        parse_errorf(line, "Extra token at end of line %s.", token_to_string(word));
+        parse_errorf(line, D_EXTRA, token_to_string(word));
         return;
     }
 
@@ -6,6 +6,10 @@
 // entry
 void parse_program(int *count);
 
+// parse up to the next operation and add it to the IR, recording errors
+// in the lines before it as usual; returns 0 at end of input instead
+int parse_next(void);
+
 // finish operations
 void finish_memop(Token first, int line);
 void finish_loadI(int line);
@@ -0,0 +1,153 @@
+#include "perf.h"
+
+#ifdef PERF_COUNTERS
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "diag.h"
+#include "error.h"
+#include "scanner.h"
+
+#define MAX_PHASES 16
+
+enum { C_CYCLES, C_INSNS, C_BRANCH_MISS, C_L1D_MISS, C_LLC_MISS, NCOUNTERS };
+
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} counter_spec[NCOUNTERS] = {
+    [C_CYCLES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    [C_INSNS] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    [C_BRANCH_MISS] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    [C_L1D_MISS] = {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    [C_LLC_MISS] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+};
+
+typedef struct {
+    const char *name;
+    uint64_t count[NCOUNTERS];
+    double ms;
+} Phase;
+
+static Phase phases[MAX_PHASES];
+static int nphases;
+static Phase *current;
+static struct timespec started;
+
+static int fds[NCOUNTERS];
+static int opened;  // 0 before the first phase, 1 after
+static int open_error;
+
+static void open_counters(void) {
+    opened = 1;
+    for (int i = 0; i < NCOUNTERS; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = counter_spec[i].type;
+        attr.config = counter_spec[i].config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fds[i] < 0 && !open_error) open_error = errno;
+    }
+}
+
+void perf_begin(const char *phase) {
+    if (!opened) open_counters();
+
+    current = NULL;
+    for (int i = 0; i < nphases; i++) {
+        if (strcmp(phases[i].name, phase) == 0) current = &phases[i];
+    }
+    if (!current) {
+        if (nphases == MAX_PHASES) return;
+        current = &phases[nphases++];
+        current->name = phase;
+    }
+
+    for (int i = 0; i < NCOUNTERS; i++) {
+        if (fds[i] < 0) continue;
+        ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &started);
+}
+
+void perf_end(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (!current) return;
+
+    for (int i = 0; i < NCOUNTERS; i++) {
+        uint64_t v;
+        if (fds[i] < 0) continue;
+        ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fds[i], &v, sizeof(v)) == (ssize_t)sizeof(v)) current->count[i] += v;
+    }
+    current->ms += (now.tv_sec - started.tv_sec) * 1e3 + (now.tv_nsec - started.tv_nsec) / 1e6;
+    current = NULL;
+}
+
+void perf_scan(int fd) {
+    sb_init(fd);
+    perf_begin("scan");
+    while (get_next_token().type != TOK_EOF) {
+    }
+    perf_end();
+    sb_free();
+
+    diag_reset();
+    error_flag = 0;
+    lseek(fd, 0, SEEK_SET);
+}
+
+// misses per thousand instructions, or n/a without both counters
+static void print_per_ki(Phase *p, int c) {
+    if (fds[c] < 0 || fds[C_INSNS] < 0 || p->count[C_INSNS] == 0)
+        fprintf(stderr, " %11s", "n/a");
+    else
+        fprintf(stderr, " %11.2f", 1000.0 * p->count[c] / p->count[C_INSNS]);
+}
+
+void perf_report(void) {
+    if (open_error) {
+        int none = 1;
+        for (int c = 0; c < NCOUNTERS; c++) none &= fds[c] < 0;
+        fprintf(stderr, "Perf: %s counters unavailable (%s)\n", none ? "hardware" : "some",
+                strerror(open_error));
+    }
+    fprintf(stderr, "%-16s %10s %14s %14s %6s %11s %11s %11s\n", "phase", "ms", "cycles",
+            "instructions", "IPC", "br-miss/ki", "L1d-miss/ki", "LLC-miss/ki");
+    for (int i = 0; i < nphases; i++) {
+        Phase *p = &phases[i];
+        fprintf(stderr, "%-16s %10.3f", p->name, p->ms);
+        for (int c = C_CYCLES; c <= C_INSNS; c++) {
+            if (fds[c] < 0)
+                fprintf(stderr, " %14s", "n/a");
+            else
+                fprintf(stderr, " %14llu", (unsigned long long)p->count[c]);
+        }
+        if (fds[C_CYCLES] < 0 || fds[C_INSNS] < 0 || p->count[C_CYCLES] == 0)
+            fprintf(stderr, " %6s", "n/a");
+        else
+            fprintf(stderr, " %6.2f", (double)p->count[C_INSNS] / p->count[C_CYCLES]);
+        print_per_ki(p, C_BRANCH_MISS);
+        print_per_ki(p, C_L1D_MISS);
+        print_per_ki(p, C_LLC_MISS);
+        fprintf(stderr, "\n");
+    }
+}
+
+#endif
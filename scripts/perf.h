@@ -0,0 +1,25 @@
+#ifndef PERF_H
+#define PERF_H
+
+// per-phase hardware counters, built in with make PERF=1. Each phase is
+// bracketed by perf_begin/perf_end; perf_report prints cycles, IPC and
+// branch, L1d and LLC misses per thousand instructions for each one to
+// stderr. Where perf_event_open is refused (no PMU, a container, a
+// high perf_event_paranoid) only the wall time is reported
+#ifdef PERF_COUNTERS
+void perf_begin(const char *phase);
+void perf_end(void);
+void perf_report(void);
+
+// scanning runs inside parsing, one token at a time; this times a dry
+// scan of the regular file fd as phase "scan", so "parse" can be read
+// against it. Errors it finds are dropped: the real pass reports them
+void perf_scan(int fd);
+#else
+#define perf_begin(phase) ((void)0)
+#define perf_end() ((void)0)
+#define perf_report() ((void)0)
+#define perf_scan(fd) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,151 @@
+#include "pressure.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ir.h"
+
+#define SERIES_PER_LINE 16
+#define REGS_LISTED 24  // source registers named per region, the rest counted
+#define BAR_WIDTH 50
+
+typedef struct {
+    int first, last;  // operation indexes
+    int peak, peak_at;
+} Region;
+
+static int by_peak(const void *a, const void *b) {
+    const Region *x = a, *y = b;
+    if (x->peak != y->peak) return y->peak - x->peak;
+    if (x->last - x->first != y->last - y->first) return (y->last - y->first) - (x->last - x->first);
+    return x->first - y->first;
+}
+
+static inline int is_reg_op1(IROpcode op) {
+    return op != IR_LOADI && op != IR_OUTPUT && op != IR_NOP;
+}
+
+static void note(IROperand *op, int index, int *start, int *end, int *sr_of) {
+    if (index < start[op->vr]) start[op->vr] = index;
+    if (index > end[op->vr]) end[op->vr] = index;
+    sr_of[op->vr] = op->sr;
+}
+
+void ir_pressure_report(int k, int top) {
+    IRNode *head = ir_head();
+    int n = block_len;
+    int nvr = vr_count > 0 ? vr_count : 1;
+
+    IRNode **at = malloc((n > 0 ? n : 1) * sizeof(IRNode *));
+    int *start = malloc(nvr * sizeof(int));  // first op where the VR is live
+    int *end = malloc(nvr * sizeof(int));    // its last use (or its definition)
+    int *sr_of = malloc(nvr * sizeof(int));
+    char *defined = calloc(nvr, 1);
+    for (int v = 0; v < nvr; v++) {
+        start[v] = INT_MAX;
+        end[v] = -1;
+    }
+
+    int index = 0;
+    for (IRNode *p = head->next; p != head; p = p->next, index++) {
+        at[index] = p;
+        if (is_reg_op1(p->opcode)) note(&p->op1, index, start, end, sr_of);
+        if (p->op2.vr != -1) note(&p->op2, index, start, end, sr_of);
+        if (p->op3.vr != -1 && p->opcode != IR_OUTPUT) {
+            note(&p->op3, index, start, end, sr_of);
+            if (p->opcode != IR_STORE) defined[p->op3.vr] = 1;
+        }
+    }
+    // values used before any definition are live from the top of the block
+    for (int v = 0; v < vr_count; v++) {
+        if (!defined[v] && end[v] >= 0) start[v] = 0;
+    }
+
+    int peak_at = 0;
+    for (int i = 0; i < n; i++) {
+        if (live_at[i] > live_at[peak_at]) peak_at = i;
+    }
+    printf("Pressure: %d operations, %d VRs, max live %d", n, vr_count, max_live);
+    if (n > 0) printf(" at op %d (line %d)", peak_at, at[peak_at]->line);
+    printf("\n");
+
+    // live count series, value*run
+    printf("\nLive count per operation (value*run):\n");
+    int items = 0;
+    for (int i = 0; i < n;) {
+        int j = i;
+        while (j < n && live_at[j] == live_at[i]) j++;
+        if (j - i > 1)
+            printf("%s%d*%d", items % SERIES_PER_LINE ? " " : "", live_at[i], j - i);
+        else
+            printf("%s%d", items % SERIES_PER_LINE ? " " : "", live_at[i]);
+        if (++items % SERIES_PER_LINE == 0) printf("\n");
+        i = j;
+    }
+    if (items % SERIES_PER_LINE) printf("\n");
+
+    // maximal runs of operations with more than k values live
+    Region *regions = malloc((n / 2 + 1) * sizeof(Region));
+    int nregions = 0, hot_ops = 0;
+    for (int i = 0; i < n; i++) {
+        if (live_at[i] <= k) continue;
+        Region *r = &regions[nregions++];
+        r->first = i;
+        r->peak_at = i;
+        while (i < n && live_at[i] > k) {
+            if (live_at[i] > live_at[r->peak_at]) r->peak_at = i;
+            i++;
+        }
+        r->last = i - 1;
+        r->peak = live_at[r->peak_at];
+        hot_ops += r->last - r->first + 1;
+    }
+    printf("\nk = %d: %d operations (%.1f%%) above %d in %d regions\n", k, hot_ops,
+           n > 0 ? 100.0 * hot_ops / n : 0.0, k, nregions);
+
+    qsort(regions, nregions, sizeof(Region), by_peak);
+    if (nregions > 0) printf("\nTop regions above k:\n");
+    for (int r = 0; r < nregions && r < top; r++) {
+        Region *g = &regions[r];
+        printf("  ops %d-%d (lines %d-%d), length %d, peak %d at line %d\n", g->first, g->last,
+               at[g->first]->line, at[g->last]->line, g->last - g->first + 1, g->peak,
+               at[g->peak_at]->line);
+
+        printf("    live at peak:");
+        int listed = 0, more = 0;
+        for (int v = 0; v < vr_count; v++) {
+            if (start[v] > g->peak_at || end[v] < g->peak_at) continue;
+            if (listed++ < REGS_LISTED)
+                printf(" r%d", sr_of[v]);
+            else
+                more++;
+        }
+        if (more) printf(" (+%d more)", more);
+        printf("\n");
+    }
+
+    // histogram of operations by live count
+    int *hist = calloc(max_live + 1, sizeof(int));
+    int widest = 0;
+    for (int i = 0; i < n; i++) hist[live_at[i]]++;
+    for (int c = 0; c <= max_live; c++) {
+        if (hist[c] > widest) widest = hist[c];
+    }
+    printf("\nHistogram (operations by live count):\n");
+    for (int c = 0; c <= max_live; c++) {
+        int bar = widest ? (int)((long long)hist[c] * BAR_WIDTH / widest) : 0;
+        if (hist[c] && !bar) bar = 1;
+        printf("  %4d %c %8d ", c, c > k ? '>' : ' ', hist[c]);
+        for (int b = 0; b < bar; b++) putchar('#');
+        printf("\n");
+    }
+
+    free(hist);
+    free(regions);
+    free(defined);
+    free(sr_of);
+    free(end);
+    free(start);
+    free(at);
+}
@@ -0,0 +1,13 @@
+#ifndef PRESSURE_H
+#define PRESSURE_H
+
+// regions listed by --pressure when no count is given
+#define PRESSURE_TOP 10
+
+// print the register pressure of the renamed IR to stdout: the live
+// count at every operation (run-length encoded), the top regions where
+// more than k values are live with the source registers live at each
+// peak, and a histogram of operations by live count
+void ir_pressure_report(int k, int top);
+
+#endif
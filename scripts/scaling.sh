@@ -0,0 +1,98 @@
+#!/bin/bash
+# usage: scaling.sh binary budget k "size blocks" "register blocks" "ks"
+# times every phase of binary (built with PERF=1) on -s runs, best of 3,
+# over three sweeps: blocks of growing length, blocks of the same length
+# over growing register numbers, and the largest block at growing k. The
+# parameter of each block is the number in its name (scale<n>.i, regs<n>.i).
+# A phase fails when the fitted log-log slope of its time against the
+# parameter passes MAX_EXPONENT, or when its time per operation on the
+# largest block of a sweep passes its line in the budget file
+bin=$1
+budget=$2
+k=$3
+size_blocks=$4
+reg_blocks=$5
+ks=$6
+
+MAX_EXPONENT=${MAX_EXPONENT:-1.3}
+PHASES="scan parse rename allocate schedule emit"
+failed=0
+
+# "phase ms" for each phase of one run, the best of 3
+phase_times() {
+    for i in 1 2 3; do
+        "$bin" -s "$1" "$2" 2>&1 > /dev/null | awk '$2 ~ /^[0-9.]+$/ { print $1, $2 }'
+    done | awk '!($1 in best) || $2 < best[$1] { best[$1] = $2 } END { for (p in best) print p, best[p] }'
+}
+
+# sweep title "param k block..." with k fixed, or "param - block k..." for k
+sweep() {
+    local title=$1
+    local params=() files=() times=()
+    shift
+    if [ "$1" = "-" ]; then
+        local f=$2
+        shift 2
+        for kk in "$@"; do
+            params+=("$kk")
+            files+=("$f")
+            times+=("$(phase_times "$kk" "$f")")
+        done
+    else
+        local kk=$1
+        shift
+        for f in "$@"; do
+            params+=("$(basename "$f" | tr -dc 0-9)")
+            files+=("$f")
+            times+=("$(phase_times "$kk" "$f")")
+        done
+    fi
+
+    local last=$((${#params[@]} - 1))
+    local ops=$(grep -cv '^[[:space:]]*\(//.*\)\?$' "${files[$last]}")
+    printf "\n%s\n%-10s" "$title" "phase"
+    for p in "${params[@]}"; do printf " %9s" "$p"; done
+    printf " %9s %9s %9s\n" "exponent" "ns/op" "budget"
+
+    for phase in $PHASES; do
+        printf "%-10s" "$phase"
+        local xs="" ys=""
+        for j in "${!params[@]}"; do
+            local ms=$(echo "${times[$j]}" | awk -v p="$phase" '$1 == p { print $2 }')
+            [ -z "$ms" ] && ms=0
+            printf " %9.3f" "$ms"
+            xs="$xs ${params[$j]}"
+            ys="$ys $ms"
+        done
+        local ms=$(echo "${times[$last]}" | awk -v p="$phase" '$1 == p { print $2 }')
+        local limit=$(awk -v p="$phase" '$1 == p { print $2 }' "$budget")
+        echo "$xs|$ys|${ms:-0}|$ops|${limit:-0}|$MAX_EXPONENT" | awk -F'|' '{
+            n = split($1, x, " "); split($2, y, " ")
+            # least squares slope of log time against log parameter; times
+            # under a microsecond are clamped so a phase that does nothing
+            # fits as flat
+            for (i = 1; i <= n; i++) {
+                lx = log(x[i]); ly = log(y[i] > 0.001 ? y[i] : 0.001)
+                sx += lx; sy += ly; sxx += lx * lx; sxy += lx * ly
+            }
+            d = n * sxx - sx * sx
+            slope = d ? (n * sxy - sx * sy) / d : 0
+            ns = $4 ? 1e6 * $3 / $4 : 0
+            bad = ""
+            if (slope > $6) bad = bad " exponent"
+            if ($5 > 0 && ns > $5) bad = bad " budget"
+            printf " %9.2f %9.1f %9s%s\n", slope, ns, ($5 > 0 ? $5 : "-"), (bad ? "  FAIL:" bad : "")
+            exit (bad != "")
+        }' || failed=1
+    done
+}
+
+sweep "operations, k = $k" "$k" $size_blocks
+sweep "register numbers, k = $k" "$k" $reg_blocks
+sweep "k" - $(echo $size_blocks | awk '{ print $NF }') $ks
+
+if [ $failed -ne 0 ]; then
+    printf "\nscaling: some phases grew faster than n^%s or passed their budget\n" "$MAX_EXPONENT"
+    exit 1
+fi
+printf "\nscaling: every phase within n^%s and its budget\n" "$MAX_EXPONENT"
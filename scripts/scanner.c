@@ -2,21 +2,48 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
 
-#include "error.h"
+#include "diag.h"
+
+// pipes and other unmappable input are read in chunks this big
+#define SB_CHUNK (1 << 20)
+
+// read-ahead for input that cannot be mapped: a thread fills one chunk
+// while the scanner works through the other
+typedef struct {
+    char *data[2];
+    size_t len[2];
+    int full[2];  // filled and not yet given back by the scanner
+    int fd;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} ReadAhead;
 
 // line buffer
 typedef struct {
-    char *linebuf;
-    size_t bufsize;
+    const char *linebuf;  // the current line, in a chunk or in carry
     int bufpos;
     int lineno;   // line number
     int linelen;  // lengh of the line
-    FILE *in;
+
+    const char *chunk;  // input not yet split into lines
+    size_t chunk_len, chunk_pos;
+    int cur;          // read-ahead chunk being scanned, -1 before the first
+    int eof;          // the reader has handed over its empty last chunk
+    char *carry;      // a line that crosses chunks, put back together
+    size_t carry_cap;
+    char *map;        // the whole input when it could be mapped
+    size_t map_len;
+    ReadAhead *ra;
 } ScannerBuffer;
 
 typedef struct {
@@ -32,37 +59,142 @@ static int tb_recording;
 Below are functions for linebuffer.
 */
 
-// initialize scan buffer
-void sb_init(FILE *in) {
-    sb = malloc(sizeof(ScannerBuffer));
+static void *read_ahead(void *arg) {
+    ReadAhead *ra = arg;
 
-    sb->linebuf = NULL;
+    // an empty chunk marks the end of input
+    for (int i = 0;; i ^= 1) {
+        pthread_mutex_lock(&ra->lock);
+        while (ra->full[i]) pthread_cond_wait(&ra->changed, &ra->lock);
+        pthread_mutex_unlock(&ra->lock);
 
-    sb->bufsize = 0;
-    sb->bufpos = 0;
+        size_t len = 0;
+        while (len < SB_CHUNK) {
+            ssize_t n = read(ra->fd, ra->data[i] + len, SB_CHUNK - len);
+            if (n <= 0) break;
+            len += (size_t)n;
+        }
+
+        pthread_mutex_lock(&ra->lock);
+        ra->len[i] = len;
+        ra->full[i] = 1;
+        pthread_cond_signal(&ra->changed);
+        pthread_mutex_unlock(&ra->lock);
+        if (len == 0) return NULL;
+    }
+}
+
+// move to the next chunk of input; returns 0 at end of input
+static int sb_next_chunk(void) {
+    ReadAhead *ra = sb->ra;
+    if (!ra || sb->eof) return 0;  // a mapped file is a single chunk
+
+    pthread_mutex_lock(&ra->lock);
+    if (sb->cur >= 0) {
+        ra->full[sb->cur] = 0;
+        pthread_cond_signal(&ra->changed);
+    }
+    sb->cur = sb->cur == 0 ? 1 : 0;
+    while (!ra->full[sb->cur]) pthread_cond_wait(&ra->changed, &ra->lock);
+    pthread_mutex_unlock(&ra->lock);
+
+    sb->chunk = ra->data[sb->cur];
+    sb->chunk_len = ra->len[sb->cur];
+    sb->chunk_pos = 0;
+    sb->eof = sb->chunk_len == 0;
+    return !sb->eof;
+}
+
+// initialize scan buffer: map a regular file, else start reading ahead
+void sb_init(int fd) {
+    sb = calloc(1, sizeof(ScannerBuffer));
     sb->lineno = 1;
-    sb->linelen = 0;
+    sb->cur = -1;
+
+    struct stat st;
+    int regular = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+    if (regular && st.st_size == 0) return;  // nothing to read
+    if (regular) {
+        void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            madvise(p, st.st_size, MADV_SEQUENTIAL);
+            sb->map = p;
+            sb->map_len = (size_t)st.st_size;
+            sb->chunk = sb->map;
+            sb->chunk_len = sb->map_len;
+            return;
+        }
+    }
 
-    sb->in = in;
+    ReadAhead *ra = calloc(1, sizeof(ReadAhead));
+    ra->data[0] = malloc(SB_CHUNK);
+    ra->data[1] = malloc(SB_CHUNK);
+    ra->fd = fd;
+    pthread_mutex_init(&ra->lock, NULL);
+    pthread_cond_init(&ra->changed, NULL);
+    pthread_create(&ra->thread, NULL, read_ahead, ra);
+    sb->ra = ra;
 }
 
 // free scan buffer
 void sb_free() {
-    if (sb->linebuf) free(sb->linebuf);
+    ReadAhead *ra = sb->ra;
+    if (ra) {
+        // let the reader run to the end of input if the scan stopped early
+        while (sb_next_chunk()) {
+        }
+        pthread_join(ra->thread, NULL);
+        pthread_mutex_destroy(&ra->lock);
+        pthread_cond_destroy(&ra->changed);
+        free(ra->data[0]);
+        free(ra->data[1]);
+        free(ra);
+    }
+    if (sb->map) munmap(sb->map, sb->map_len);
+    free(sb->carry);
     free(sb);
 }
 
-// refill scan buffer
+static void carry_append(const char *p, size_t n, size_t *len) {
+    if (*len + n > sb->carry_cap) {
+        sb->carry_cap = 2 * (*len + n);
+        sb->carry = realloc(sb->carry, sb->carry_cap);
+    }
+    memcpy(sb->carry + *len, p, n);
+    *len += n;
+}
+
+// refill scan buffer with the next line, '\n' included. A line inside one
+// chunk is scanned in place; one that crosses chunks is copied into carry
 static int sb_refill() {
-    sb->linebuf = NULL;
-    ssize_t nread = getline(&sb->linebuf, &sb->bufsize, sb->in);
+    size_t carried = 0;
+
+    for (;;) {
+        if (sb->chunk_pos == sb->chunk_len && !sb_next_chunk()) break;
+
+        const char *start = sb->chunk + sb->chunk_pos;
+        size_t left = sb->chunk_len - sb->chunk_pos;
+        const char *nl = memchr(start, '\n', left);
+        size_t n = nl ? (size_t)(nl - start) + 1 : left;
+        sb->chunk_pos += n;
+
+        if (nl && carried == 0) {
+            sb->linebuf = start;
+            sb->linelen = (int)n;
+            sb->bufpos = 0;
+            return 1;
+        }
+        carry_append(start, n, &carried);
+        if (nl) break;
+    }
 
     // reaching end of file
-    if (nread == -1) {
+    if (carried == 0) {
         return 0;
     }
+    sb->linebuf = sb->carry;
+    sb->linelen = (int)carried;
     sb->bufpos = 0;
-    sb->linelen = (int)nread;
 
     return 1;
 }
@@ -115,8 +247,7 @@ static Token make_token(TokenType t, int value, int line) {
 
 // helper function for reporting error
 static Token report_error(void) {
-    fprintf(stderr, "ERROR %d:\t\"%s\" is not a valid word.\n",
-            sb->lineno, tb.buf);
+    diag_error(sb->lineno, D_BAD_WORD, tb.buf, tb.bufpos);
 
     // debug: print numeric values of buffer contents
     // printf("tb.buf codes: ");
@@ -132,8 +263,6 @@ static Token report_error(void) {
             ;
         }
     }
-    error_flag = 1;
-
     return make_token(TOK_EOL, 0, sb->lineno++);
 }
 
@@ -43,8 +43,8 @@ typedef struct{
 // Scanner interface, return the next token from input stream
 Token get_next_token();
 
-// functions for scanner buffer 
-void sb_init(FILE *in);
+// functions for scanner buffer; fd may be a pipe
+void sb_init(int fd);
 void sb_free();
 
 #endif
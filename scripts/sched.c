@@ -0,0 +1,447 @@
+#include "sched.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ir.h"
+
+/*
+Dependence graph over the allocated block. Nodes are numbered in block
+order and every edge goes from an earlier node to a later one.
+*/
+
+typedef struct {
+    int n;
+    IRNode **nodes;
+    int *lat;         // latency of each node
+    int *succ_head;   // first outgoing edge, -1 if none
+    int *npred;       // incoming edge count
+
+    int nedges, cap;
+    int *e_to, *e_lat, *e_next;
+} DepGraph;
+
+// uses recorded since the last def of a PR, or memory reads since the last
+// store; chained through a shared pool so the graph stays linear in size
+typedef struct {
+    int *node;
+    int *next;
+    int top;
+} ReaderPool;
+
+static void add_edge(DepGraph *g, int from, int to, int lat) {
+    if (g->nedges == g->cap) {
+        g->cap = g->cap ? 2 * g->cap : 1024;
+        g->e_to = realloc(g->e_to, g->cap * sizeof(int));
+        g->e_lat = realloc(g->e_lat, g->cap * sizeof(int));
+        g->e_next = realloc(g->e_next, g->cap * sizeof(int));
+    }
+    int e = g->nedges++;
+    g->e_to[e] = to;
+    g->e_lat[e] = lat;
+    g->e_next[e] = g->succ_head[from];
+    g->succ_head[from] = e;
+    g->npred[to]++;
+}
+
+static int node_latency(IRNode *n) {
+    switch (n->opcode) {
+        case IR_LOAD:
+            return LAT_LOAD;
+        case IR_STORE:
+            return LAT_STORE;
+        default:
+            return LAT_DEFAULT;
+    }
+}
+
+static void push_reader(ReaderPool *rp, int *head, int node) {
+    rp->node[rp->top] = node;
+    rp->next[rp->top] = *head;
+    *head = rp->top++;
+}
+
+// true dependence on the value in pr, and remember the read for later defs
+static void reg_use(DepGraph *g, ReaderPool *rp, int *last_def, int *readers,
+                    int pr, int i) {
+    if (last_def[pr] != -1) add_edge(g, last_def[pr], i, g->lat[last_def[pr]]);
+    push_reader(rp, &readers[pr], i);
+}
+
+// a def waits for earlier readers (anti) and earlier writes (output)
+static void reg_def(DepGraph *g, int *last_def, int *readers, ReaderPool *rp,
+                    int pr, int i) {
+    for (int r = readers[pr]; r != -1; r = rp->next[r]) {
+        if (rp->node[r] != i) add_edge(g, rp->node[r], i, LAT_DEFAULT);
+    }
+    if (last_def[pr] != -1) add_edge(g, last_def[pr], i, g->lat[last_def[pr]]);
+    readers[pr] = -1;
+    last_def[pr] = i;
+}
+
+/*
+Memory dependences. Accesses to different known words never conflict; an
+access with an unknown address is ordered against everything it might touch.
+*/
+
+typedef struct {
+    int key;         // word address, -1 if the slot is empty
+    int epoch;       // entries older than the last unknown store are stale
+    int last_store;
+    int readers;
+} AddrEntry;
+
+typedef struct {
+    AddrEntry *tab;
+    int mask;
+    int epoch;
+    int unknown_store;    // last store with an unknown address
+    int unknown_readers;  // unknown-address reads since unknown_store
+    int known_stores;     // known-address stores since unknown_store
+    int ops;              // every access since unknown_store
+    int last_output;
+} MemState;
+
+static AddrEntry *mem_entry(MemState *ms, int addr) {
+    int key = addr >> 2;
+    unsigned h = ((unsigned)key * 2654435761u) & ms->mask;
+    while (ms->tab[h].key != -1 && ms->tab[h].key != key) h = (h + 1) & ms->mask;
+
+    AddrEntry *e = &ms->tab[h];
+    if (e->key == -1 || e->epoch != ms->epoch) {
+        e->key = key;
+        e->epoch = ms->epoch;
+        e->last_store = -1;
+        e->readers = -1;
+    }
+    return e;
+}
+
+static inline int addr_known(int addr) {
+    return addr >= 0 && (addr & 3) == 0;
+}
+
+static void mem_read(DepGraph *g, ReaderPool *rp, MemState *ms, int addr, int i) {
+    if (ms->unknown_store != -1) add_edge(g, ms->unknown_store, i, LAT_STORE);
+
+    if (addr_known(addr)) {
+        AddrEntry *e = mem_entry(ms, addr);
+        if (e->last_store != -1) add_edge(g, e->last_store, i, LAT_STORE);
+        push_reader(rp, &e->readers, i);
+    } else {
+        for (int r = ms->known_stores; r != -1; r = rp->next[r]) {
+            add_edge(g, rp->node[r], i, LAT_STORE);
+        }
+        push_reader(rp, &ms->unknown_readers, i);
+    }
+    push_reader(rp, &ms->ops, i);
+}
+
+static void mem_write(DepGraph *g, ReaderPool *rp, MemState *ms, int addr, int i) {
+    if (!addr_known(addr)) {
+        // may touch any word: wait for every access since the last such store
+        for (int r = ms->ops; r != -1; r = rp->next[r]) add_edge(g, rp->node[r], i, LAT_DEFAULT);
+        if (ms->unknown_store != -1) add_edge(g, ms->unknown_store, i, LAT_DEFAULT);
+        ms->unknown_store = i;
+        ms->unknown_readers = ms->known_stores = ms->ops = -1;
+        ms->epoch++;
+        return;
+    }
+
+    AddrEntry *e = mem_entry(ms, addr);
+    if (e->last_store != -1) add_edge(g, e->last_store, i, LAT_DEFAULT);
+    for (int r = e->readers; r != -1; r = rp->next[r]) add_edge(g, rp->node[r], i, LAT_DEFAULT);
+    if (ms->unknown_store != -1) add_edge(g, ms->unknown_store, i, LAT_DEFAULT);
+    for (int r = ms->unknown_readers; r != -1; r = rp->next[r]) {
+        add_edge(g, rp->node[r], i, LAT_DEFAULT);
+    }
+    e->last_store = i;
+    e->readers = -1;
+    push_reader(rp, &ms->known_stores, i);
+    push_reader(rp, &ms->ops, i);
+}
+
+static void build_graph(DepGraph *g) {
+    IRNode *head = ir_head();
+    int max_pr = 0;
+
+    g->n = 0;
+    for (IRNode *p = head->next; p != head; p = p->next) {
+        g->n++;
+        if (p->op1.pr > max_pr) max_pr = p->op1.pr;
+        if (p->op2.pr > max_pr) max_pr = p->op2.pr;
+        if (p->op3.pr > max_pr) max_pr = p->op3.pr;
+    }
+
+    int n = g->n > 0 ? g->n : 1;
+    g->nodes = malloc(n * sizeof(IRNode *));
+    g->lat = malloc(n * sizeof(int));
+    g->succ_head = malloc(n * sizeof(int));
+    g->npred = calloc(n, sizeof(int));
+    g->nedges = g->cap = 0;
+    g->e_to = g->e_lat = g->e_next = NULL;
+
+    int *last_def = malloc((max_pr + 1) * sizeof(int));
+    int *readers = malloc((max_pr + 1) * sizeof(int));
+    for (int pr = 0; pr <= max_pr; pr++) last_def[pr] = readers[pr] = -1;
+
+    // up to two register reads and three memory chains per node
+    ReaderPool rp;
+    rp.node = malloc(6 * n * sizeof(int));
+    rp.next = malloc(6 * n * sizeof(int));
+    rp.top = 0;
+
+    MemState ms;
+    int cap = 16;
+    while (cap < 2 * n) cap <<= 1;
+    ms.tab = malloc(cap * sizeof(AddrEntry));
+    for (int j = 0; j < cap; j++) ms.tab[j].key = -1;
+    ms.mask = cap - 1;
+    ms.epoch = 0;
+    ms.unknown_store = ms.unknown_readers = ms.known_stores = ms.ops = -1;
+    ms.last_output = -1;
+
+    int i = 0;
+    for (IRNode *p = head->next; p != head; p = p->next, i++) {
+        g->nodes[i] = p;
+        g->lat[i] = node_latency(p);
+        g->succ_head[i] = -1;
+
+        switch (p->opcode) {
+            case IR_LOAD:
+                reg_use(g, &rp, last_def, readers, p->op1.pr, i);
+                mem_read(g, &rp, &ms, p->addr, i);
+                reg_def(g, last_def, readers, &rp, p->op3.pr, i);
+                break;
+
+            case IR_LOADI:
+                reg_def(g, last_def, readers, &rp, p->op3.pr, i);
+                break;
+
+            case IR_STORE:
+                reg_use(g, &rp, last_def, readers, p->op1.pr, i);
+                reg_use(g, &rp, last_def, readers, p->op3.pr, i);
+                mem_write(g, &rp, &ms, p->addr, i);
+                break;
+
+            case IR_ADD:
+            case IR_SUB:
+            case IR_MULT:
+            case IR_LSHIFT:
+            case IR_RSHIFT:
+                reg_use(g, &rp, last_def, readers, p->op1.pr, i);
+                reg_use(g, &rp, last_def, readers, p->op2.pr, i);
+                reg_def(g, last_def, readers, &rp, p->op3.pr, i);
+                break;
+
+            case IR_OUTPUT:
+                mem_read(g, &rp, &ms, p->addr, i);
+                if (ms.last_output != -1) add_edge(g, ms.last_output, i, LAT_DEFAULT);
+                ms.last_output = i;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    free(last_def);
+    free(readers);
+    free(rp.node);
+    free(rp.next);
+    free(ms.tab);
+}
+
+static void free_graph(DepGraph *g) {
+    free(g->nodes);
+    free(g->lat);
+    free(g->succ_head);
+    free(g->npred);
+    free(g->e_to);
+    free(g->e_lat);
+    free(g->e_next);
+}
+
+/*
+Binary heap of node indices, ordered by before()
+*/
+
+typedef struct {
+    int *a;
+    int size;
+    const int *key;  // larger key first
+} Heap;
+
+static inline int before(Heap *h, int x, int y) {
+    if (h->key[x] != h->key[y]) return h->key[x] > h->key[y];
+    return x < y;  // keep block order on ties
+}
+
+static void heap_push(Heap *h, int v) {
+    int i = h->size++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!before(h, v, h->a[parent])) break;
+        h->a[i] = h->a[parent];
+        i = parent;
+    }
+    h->a[i] = v;
+}
+
+static int heap_pop(Heap *h) {
+    int top = h->a[0];
+    int v = h->a[--h->size];
+    int i = 0;
+    for (;;) {
+        int c = 2 * i + 1;
+        if (c >= h->size) break;
+        if (c + 1 < h->size && before(h, h->a[c + 1], h->a[c])) c++;
+        if (!before(h, h->a[c], v)) break;
+        h->a[i] = h->a[c];
+        i = c;
+    }
+    h->a[i] = v;
+    return top;
+}
+
+int ir_estimate_cycles(void) {
+    DepGraph g;
+    build_graph(&g);
+
+    // issue in block order, one op per cycle, waiting on every edge
+    int *ready = calloc(g.n > 0 ? g.n : 1, sizeof(int));
+    int cycle = 0;
+    int finish = 0;
+    for (int i = 0; i < g.n; i++) {
+        if (ready[i] > cycle) cycle = ready[i];
+        for (int e = g.succ_head[i]; e != -1; e = g.e_next[e]) {
+            int t = cycle + g.e_lat[e];
+            if (t > ready[g.e_to[e]]) ready[g.e_to[e]] = t;
+        }
+        if (cycle + g.lat[i] > finish) finish = cycle + g.lat[i];
+        cycle++;
+    }
+
+    free(ready);
+    free_graph(&g);
+    return finish;
+}
+
+/*
+Issue limits. The lab 2 machine issues one operation per cycle; the lab 3
+machine (the simulator built with LAB3) issues two, of which at most one
+may be a load or store, one a mult and one an output.
+*/
+
+// ops popped from the ready list looking for a partner before giving up
+#define PAIR_LOOKAHEAD 8
+
+static int can_pair(IRNode *a, IRNode *b) {
+    int mem = (a->opcode == IR_LOAD || a->opcode == IR_STORE) +
+              (b->opcode == IR_LOAD || b->opcode == IR_STORE);
+    int mult = (a->opcode == IR_MULT) + (b->opcode == IR_MULT);
+    int output = (a->opcode == IR_OUTPUT) + (b->opcode == IR_OUTPUT);
+    return mem <= 1 && mult <= 1 && output <= 1;
+}
+
+// list scheduling, up to width operations per cycle. Every edge has a
+// latency of at least one, so the operations issued together never
+// depend on each other
+static int list_schedule(int width) {
+    DepGraph g;
+    build_graph(&g);
+
+    int n = g.n > 0 ? g.n : 1;
+    int *prio = malloc(n * sizeof(int));
+    int *ready = calloc(n, sizeof(int));
+    int *neg_ready = malloc(n * sizeof(int));
+    int *order = malloc(n * sizeof(int));
+    char *paired = calloc(n, 1);
+
+    // priority is the latency-weighted path length to the end of the block
+    for (int i = g.n - 1; i >= 0; i--) {
+        prio[i] = g.lat[i];
+        for (int e = g.succ_head[i]; e != -1; e = g.e_next[e]) {
+            int d = g.e_lat[e] + prio[g.e_to[e]];
+            if (d > prio[i]) prio[i] = d;
+        }
+    }
+
+    Heap avail = {malloc(n * sizeof(int)), 0, prio};
+    Heap waiting = {malloc(n * sizeof(int)), 0, neg_ready};
+
+    for (int i = 0; i < g.n; i++) {
+        if (g.npred[i] == 0) heap_push(&avail, i);
+    }
+
+    int cycle = 0;
+    int finish = 0;
+    for (int scheduled = 0; scheduled < g.n; cycle++) {
+        // operands whose producers have retired join the ready list
+        while (waiting.size > 0 && ready[waiting.a[0]] <= cycle) {
+            heap_push(&avail, heap_pop(&waiting));
+        }
+        if (avail.size == 0) {
+            // stall until the earliest waiting op is ready
+            cycle = ready[waiting.a[0]] - 1;
+            continue;
+        }
+
+        int held[PAIR_LOOKAHEAD];
+        int nheld = 0;
+        for (int slot = 0; slot < width && avail.size > 0;) {
+            int i = heap_pop(&avail);
+            if (slot > 0 && !can_pair(g.nodes[order[scheduled - 1]], g.nodes[i])) {
+                held[nheld++] = i;
+                if (nheld == PAIR_LOOKAHEAD) break;
+                continue;
+            }
+            paired[scheduled] = slot > 0;
+            order[scheduled++] = i;
+            slot++;
+            if (cycle + g.lat[i] > finish) finish = cycle + g.lat[i];
+
+            for (int e = g.succ_head[i]; e != -1; e = g.e_next[e]) {
+                int s = g.e_to[e];
+                int t = cycle + g.e_lat[e];
+                if (t > ready[s]) ready[s] = t;
+                if (--g.npred[s] == 0) {
+                    neg_ready[s] = -ready[s];
+                    heap_push(&waiting, s);
+                }
+            }
+        }
+        while (nheld > 0) heap_push(&avail, held[--nheld]);
+    }
+
+    // relink the node list in schedule order
+    IRNode *head = ir_head();
+    IRNode *prev = head;
+    for (int j = 0; j < g.n; j++) {
+        IRNode *p = g.nodes[order[j]];
+        p->bundled = paired[j];
+        prev->next = p;
+        p->prev = prev;
+        prev = p;
+    }
+    prev->next = head;
+    head->prev = prev;
+
+    free(prio);
+    free(ready);
+    free(neg_ready);
+    free(order);
+    free(paired);
+    free(avail.a);
+    free(waiting.a);
+    free_graph(&g);
+    return finish;
+}
+
+int ir_schedule(void) {
+    return list_schedule(1);
+}
+
+int ir_bundle(void) {
+    return list_schedule(2);
+}
@@ -0,0 +1,20 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+// operation latencies, matching opcode_specs in the lab 2 simulator
+#define LAT_LOAD 3
+#define LAT_STORE 3
+#define LAT_DEFAULT 1
+
+// reorder the allocated block to hide load/store latency; returns the
+// estimated cycle count of the new order
+int ir_schedule(void);
+
+// the same for the lab 3 machine: pack independent operations two to a
+// cycle within its unit limits, marking the second of each pair bundled
+int ir_bundle(void);
+
+// estimated cycles for the block in its current order
+int ir_estimate_cycles(void);
+
+#endif
@@ -0,0 +1,53 @@
+#include "stalls.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "alloc.h"
+#include "ir.h"
+
+int stalls_load(const char *filename, int k) {
+    FILE *f = fopen(filename, "r");
+    if (!f) {
+        fprintf(stderr, "ERROR: Could not open stall profile '%s'\n", filename);
+        return -1;
+    }
+
+    int lines;
+    int *map = alloc_replay(k, &lines);
+    int *weights = calloc(block_len > 0 ? block_len : 1, sizeof(int));
+    char buf[256];
+    int at = 0, outside = 0, total = 0, ops = 0;
+
+    while (fgets(buf, sizeof buf, f)) {
+        int line, reg, mem;
+        at++;
+        if (buf[0] == '/' || buf[0] == '\n') continue;
+        if (sscanf(buf, "%d %d %d", &line, &reg, &mem) != 3 || reg < 0 || mem < 0) {
+            fprintf(stderr, "ERROR: %s:%d: expected 'line register-cycles memory-cycles'\n",
+                    filename, at);
+            fclose(f);
+            free(map);
+            free(weights);
+            return -1;
+        }
+        if (line < 1 || line > lines) {
+            outside++;
+            continue;
+        }
+        if (weights[map[line - 1]] == 0) ops++;
+        weights[map[line - 1]] += reg + mem;
+        total += reg + mem;
+    }
+    fclose(f);
+    free(map);
+
+    if (outside)
+        fprintf(stderr, "Stall profile: %d lines past the %d the allocation prints; was it made "
+                        "from this block at k = %d?\n", outside, lines, k);
+    fprintf(stderr, "Stall profile: %d stall cycles on %d operations\n", total, ops);
+
+    // the allocator keeps the weights for the rest of the run
+    alloc_stall_weights(weights);
+    return 0;
+}
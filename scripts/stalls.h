@@ -0,0 +1,13 @@
+#ifndef STALLS_H
+#define STALLS_H
+
+// load a stall profile written by the simulator's -p option for the plain
+// allocation of this block at k (412alloc k file > out.i, then
+// sim -r k -p profile < out.i) and bias the next allocation away from
+// the operations that stalled. Profile lines are output lines, so the
+// plain allocation is replayed to map them back to operations; cycles on
+// spill code count against the operation it was inserted for. Returns 0
+// on success, -1 if the profile cannot be read
+int stalls_load(const char *filename, int k);
+
+#endif
@@ -0,0 +1,243 @@
+#include "stream.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "alloc.h"
+#include "error.h"
+#include "ir.h"
+#include "parser.h"
+#include "scanner.h"
+
+// one operation in the side file, by its index in the block; -1 for none
+typedef struct {
+    int32_t opcode;
+    int32_t line;
+    int32_t sr[3];   // op1..op3; a constant in sr[0] for loadI and output
+    int32_t nu[3];   // next use of each operand
+    int32_t hot[2];  // next op after this one with more than k, k-1 live
+} StreamRec;
+
+/*
+Per-register state for the reverse scan, grown as larger registers show up
+*/
+
+static char *sr_live;  // value in the register is needed further down
+static int *sr_lu;     // position of its next use, -1 if none
+static int sr_cap;
+static int max_sr;
+
+static void sr_reserve(int sr) {
+    if (sr > max_sr) max_sr = sr;
+    if (sr < sr_cap) return;
+    int cap = sr_cap ? sr_cap : 64;
+    while (cap <= sr) cap *= 2;
+    sr_live = realloc(sr_live, cap);
+    sr_lu = realloc(sr_lu, cap * sizeof(int));
+    memset(sr_live + sr_cap, 0, cap - sr_cap);
+    for (int i = sr_cap; i < cap; i++) sr_lu[i] = -1;
+    sr_cap = cap;
+}
+
+static inline int has_def(int op) {
+    return op != IR_STORE && op != IR_OUTPUT && op != IR_NOP;
+}
+
+static void use(StreamRec *r, int i, int *live) {
+    sr_reserve(r->sr[i]);
+    if (!sr_live[r->sr[i]]) {
+        sr_live[r->sr[i]] = 1;
+        (*live)++;
+    }
+}
+
+// the bookkeeping of ir_rename for one operation at index pos;
+// registers keep their own names, since every definition ends the value
+// before it. Returns the number of values live across the operation
+static int rename_rec(StreamRec *r, int pos, int *live) {
+    int here = *live;
+    r->nu[0] = r->nu[1] = r->nu[2] = -1;
+
+    if (has_def(r->opcode)) {
+        int d = r->sr[2];
+        sr_reserve(d);
+        if (!sr_live[d]) {
+            // dead definition still needs a register for one op
+            if (*live + 1 > here) here = *live + 1;
+        } else {
+            (*live)--;
+        }
+        r->nu[2] = sr_lu[d];
+        sr_live[d] = 0;
+        sr_lu[d] = -1;
+    }
+
+    // read every next use before updating, as ir_rename does
+    switch (r->opcode) {
+        case IR_LOAD:
+            use(r, 0, live);
+            r->nu[0] = sr_lu[r->sr[0]];
+            sr_lu[r->sr[0]] = pos;
+            break;
+        case IR_STORE:
+            use(r, 0, live);
+            use(r, 2, live);
+            r->nu[0] = sr_lu[r->sr[0]];
+            r->nu[2] = sr_lu[r->sr[2]];
+            sr_lu[r->sr[0]] = sr_lu[r->sr[2]] = pos;
+            break;
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MULT:
+        case IR_LSHIFT:
+        case IR_RSHIFT:
+            use(r, 0, live);
+            use(r, 1, live);
+            r->nu[0] = sr_lu[r->sr[0]];
+            r->nu[1] = sr_lu[r->sr[1]];
+            sr_lu[r->sr[0]] = sr_lu[r->sr[1]] = pos;
+            break;
+        default:
+            break;
+    }
+    return *live > here ? *live : here;
+}
+
+static FILE *side_file(void) {
+    const char *dir = getenv("TMPDIR");
+    if (!dir || !*dir) dir = "/tmp";
+    size_t n = strlen(dir) + 32;
+    char *path = malloc(n);
+    snprintf(path, n, "%s/412alloc.XXXXXX", dir);
+
+    int fd = mkstemp(path);
+    FILE *f = NULL;
+    if (fd >= 0) {
+        unlink(path);
+        f = fdopen(fd, "w+b");
+    }
+    if (!f) fprintf(stderr, "ERROR: could not create side file in '%s'\n", dir);
+    free(path);
+    return f;
+}
+
+static inline int position(int32_t pos) {
+    return pos == -1 ? INT_MAX : pos;
+}
+
+// turn a record back into a node, with VR names equal to register names
+static IRNode *build_rec(StreamRec *r) {
+    IRNode *n = ir_build((IROpcode)r->opcode, r->line, 0);
+    IROperand *ops[3] = {&n->op1, &n->op2, &n->op3};
+    for (int i = 0; i < 3; i++) {
+        ops[i]->sr = r->sr[i];
+        if (r->sr[i] != -1 && !(i == 0 && (r->opcode == IR_LOADI || r->opcode == IR_OUTPUT))) {
+            ops[i]->vr = r->sr[i];
+            ops[i]->nu = position(r->nu[i]);
+        }
+    }
+    return n;
+}
+
+// read or write count records starting at record from
+static int side_io(int fd, StreamRec *win, int count, int from, int write) {
+    size_t n = count * sizeof(StreamRec);
+    off_t at = (off_t)from * sizeof(StreamRec);
+    ssize_t done = write ? pwrite(fd, win, n, at) : pread(fd, win, n, at);
+    if (done == (ssize_t)n) return 1;
+    fprintf(stderr, "ERROR: could not %s side file\n", write ? "write" : "read");
+    return 0;
+}
+
+int stream_allocate(const char *filename, int k) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "ERROR: Could not open file '%s'\n", filename);
+        return -1;
+    }
+
+    FILE *side = side_file();
+    if (!side) {
+        close(fd);
+        return -1;
+    }
+
+    // parse: the scanner and parser of the normal path, one operation at a
+    // time, each written out as a record and dropped from the IR
+    int ops = 0;
+    sb_init(fd);
+    while (parse_next()) {
+        IRNode *n = ir_head()->next;
+        StreamRec r;
+        r.opcode = n->opcode;
+        r.line = n->line;
+        r.sr[0] = n->op1.sr;
+        r.sr[1] = n->op2.sr;
+        r.sr[2] = n->op3.sr;
+        fwrite(&r, sizeof(r), 1, side);
+        ir_reset_nodes();
+        ops++;
+    }
+    sb_free();
+    close(fd);
+    if (error_flag || fflush(side) != 0) {
+        fclose(side);
+        return -1;
+    }
+
+    // rename: the records from the last one up, a window at a time,
+    // rewritten in place with next uses and the next hot operation
+    int sfd = fileno(side);
+    StreamRec *win = malloc(STREAM_WINDOW * sizeof(StreamRec));
+    int live = 0, max_live_seen = 0;
+    int hot_k = -1, hot_k1 = -1;
+    int ok = 1;
+    for (int end = ops; end > 0 && ok;) {
+        int count = end < STREAM_WINDOW ? end : STREAM_WINDOW;
+        int from = end - count;
+        ok = side_io(sfd, win, count, from, 0);
+        for (int j = count - 1; j >= 0 && ok; j--) {
+            StreamRec *r = &win[j];
+            r->hot[0] = hot_k;
+            r->hot[1] = hot_k1;
+            int here = rename_rec(r, from + j, &live);
+            if (here > max_live_seen) max_live_seen = here;
+            if (here > k) hot_k = from + j;
+            if (here > k - 1) hot_k1 = from + j;
+        }
+        ok = ok && side_io(sfd, win, count, from, 1);
+        end = from;
+    }
+
+    free(sr_live);
+    free(sr_lu);
+    sr_live = NULL;
+    sr_lu = NULL;
+    sr_cap = 0;
+
+    // allocate: the records in order, a window at a time
+    if (ok) {
+        alloc_begin(k, max_sr + 1, max_live_seen, 1);
+        int which = alloc_hot_limit() == k ? 0 : 1;
+        for (int index = 0; index < ops && ok;) {
+            int count = ops - index < STREAM_WINDOW ? ops - index : STREAM_WINDOW;
+            ok = side_io(sfd, win, count, index, 0);
+            for (int j = 0; j < count && ok; j++, index++) {
+                IRNode *n = build_rec(&win[j]);
+                alloc_step(n, index, position(win[j].hot[which]));
+            }
+            ir_reset_nodes();
+        }
+        alloc_end();
+    }
+
+    free(win);
+    fclose(side);
+    max_sr = 0;
+    return ok ? 0 : -1;
+}
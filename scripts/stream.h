@@ -0,0 +1,19 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+// operations read from the side file at a time in streaming mode; the IR
+// never holds more than one window, as spill code goes straight to the
+// output
+#define STREAM_WINDOW 256
+
+// allocate filename onto k registers without holding the block in memory.
+// The scanner and parser of the normal path write each operation to a
+// side file of fixed-size records as they read it; a backward pass over
+// the file fills in next uses a window at a time, and a forward one reads
+// it back a window at a time and allocates and prints it. Memory is
+// bounded by the largest register number and the window.
+// Returns 0 on success; on syntax errors it records every bad line (see
+// diag.h) and prints nothing on stdout
+int stream_allocate(const char *filename, int k);
+
+#endif
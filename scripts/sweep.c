@@ -0,0 +1,135 @@
+#include "sweep.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "alloc.h"
+#include "ir.h"
+#include "opt.h"
+#include "sched.h"
+
+// what a child sends back over its pipe
+typedef struct {
+    AllocStats stats;
+    int cycles;  // estimated, after scheduling when that was asked for
+} SweepResult;
+
+typedef struct {
+    pid_t pid;
+    int fd;  // read end of the child's pipe
+    int k;
+} Child;
+
+static char *output_name(const char *filename, int k) {
+    if (strcmp(filename, "-") == 0) filename = "stdin";
+    const char *base = strrchr(filename, '/');
+    base = base ? base + 1 : filename;
+    int len = (int)strlen(base);
+    if (len > 2 && strcmp(base + len - 2, ".i") == 0) len -= 2;
+
+    size_t n = len + 16;
+    char *name = malloc(n);
+    snprintf(name, n, "%.*s.k%d.i", len, base, k);
+    return name;
+}
+
+// runs in the child: allocate for k, print into the output file and
+// report the numbers
+static int run_k(const char *filename, int k, int schedule, int fd) {
+    char *name = output_name(filename, k);
+    if (!freopen(name, "w", stdout)) {
+        fprintf(stderr, "ERROR: could not write '%s'\n", name);
+        return EXIT_FAILURE;
+    }
+    free(name);
+
+    SweepResult r;
+    ir_allocate(k);
+    r.cycles = schedule ? ir_schedule() : ir_estimate_cycles();
+    r.stats = alloc_stats;
+    ir_alloc_print();
+
+    if (fflush(stdout) != 0) return EXIT_FAILURE;
+    // smaller than PIPE_BUF, so one write and it never blocks on the parent
+    if (write(fd, &r, sizeof(r)) != (ssize_t)sizeof(r)) return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
+
+// wait for any child and collect its result; returns 0 if it failed
+static int reap(Child *running, int *nrun, SweepResult *results, char *done) {
+    int status;
+    pid_t pid = wait(&status);
+
+    for (int i = 0; i < *nrun; i++) {
+        if (running[i].pid != pid) continue;
+        Child c = running[i];
+        running[i] = running[--*nrun];
+
+        SweepResult *r = &results[c.k];
+        int ok = WIFEXITED(status) && WEXITSTATUS(status) == 0 &&
+                 read(c.fd, r, sizeof(*r)) == (ssize_t)sizeof(*r);
+        close(c.fd);
+        done[c.k] = ok;
+        if (!ok) fprintf(stderr, "ERROR: allocation for k=%d failed\n", c.k);
+        return ok;
+    }
+    return 1;
+}
+
+int sweep_allocate(const char *filename, int k_lo, int k_hi, int jobs, int schedule) {
+    SweepResult results[MAX_K + 1];
+    char done[MAX_K + 1] = {0};
+    Child *running = malloc(jobs * sizeof(Child));
+    int nrun = 0, failed = 0;
+
+    // estimated cycles only see memory dependences through known addresses
+    ir_find_addresses();
+
+    // children inherit stdout's buffer; make sure it is empty
+    fflush(stdout);
+
+    for (int k = k_lo; k <= k_hi; k++) {
+        if (nrun == jobs && !reap(running, &nrun, results, done)) failed = 1;
+
+        int fds[2];
+        if (pipe(fds) != 0) {
+            perror("ERROR: pipe");
+            failed = 1;
+            break;
+        }
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("ERROR: fork");
+            close(fds[0]);
+            close(fds[1]);
+            failed = 1;
+            break;
+        }
+        if (pid == 0) {
+            close(fds[0]);
+            _exit(run_k(filename, k, schedule, fds[1]));
+        }
+        close(fds[1]);
+        running[nrun++] = (Child){pid, fds[0], k};
+    }
+    while (nrun > 0) {
+        if (!reap(running, &nrun, results, done)) failed = 1;
+    }
+    free(running);
+
+    printf("%4s %8s %8s %8s %8s %8s %8s %8s\n", "k", "spills", "restores", "hidden", "remats",
+           "splits", "slots", "cycles");
+    for (int k = k_lo; k <= k_hi; k++) {
+        if (!done[k]) {
+            printf("%4d %8s\n", k, "failed");
+            continue;
+        }
+        AllocStats *s = &results[k].stats;
+        printf("%4d %8d %8d %8d %8d %8d %8d %8d\n", k, s->spills, s->restores, s->hidden,
+               s->remats, s->splits, s->slots, results[k].cycles);
+    }
+    return failed ? -1 : 0;
+}
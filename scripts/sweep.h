@@ -0,0 +1,13 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+// allocate the parsed and renamed block once for each k in [k_lo, k_hi],
+// scheduling it too when schedule is set. Each k runs in a forked child
+// that shares the IR copy-on-write, at most jobs at a time; child k
+// writes <stem>.k<k>.i in the current directory, where stem is the input's
+// name without its directory and .i suffix ("stdin" for -). A table of
+// spills, restores and estimated cycles per k goes to stdout. Returns 0
+// when every k succeeded
+int sweep_allocate(const char *filename, int k_lo, int k_hi, int jobs, int schedule);
+
+#endif
@@ -0,0 +1,368 @@
+#include "verify.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "ir.h"
+#include "sched.h"
+
+#define MEM_WORDS (VERIFY_MEMORY / 4)
+#define MAX_REPORTS 10  // differences printed before the rest are counted
+
+VerifyStats verify_stats;
+
+// one operation with its register fields resolved to plain numbers
+typedef struct {
+    IROpcode opcode;
+    int a, b, c;  // op1, op2 and op3: SRs in the original, PRs once allocated
+    int line;
+    int bundled;  // issues with the op before it (--bundle)
+} VOp;
+
+// result of interpreting one block
+typedef struct {
+    int *out;
+    int nout;
+    int cycles;
+    unsigned *mem;    // final memory, one word per 4 bytes
+    char *written;    // words stored to by the block
+    int failed;       // stopped on an error
+} VRun;
+
+static VOp *orig;
+static int orig_len;
+
+// copy the node list, taking register numbers from sr or pr
+static VOp *snapshot(int *len, int use_pr) {
+    IRNode *head = ir_head();
+    int n = 0;
+    for (IRNode *p = head->next; p != head; p = p->next) n++;
+
+    VOp *ops = malloc((n > 0 ? n : 1) * sizeof(VOp));
+    int i = 0;
+    for (IRNode *p = head->next; p != head; p = p->next, i++) {
+        ops[i].opcode = p->opcode;
+        ops[i].line = p->line;
+        ops[i].bundled = p->bundled;
+        ops[i].a = use_pr ? p->op1.pr : p->op1.sr;
+        ops[i].b = use_pr ? p->op2.pr : p->op2.sr;
+        ops[i].c = use_pr ? p->op3.pr : p->op3.sr;
+        // loadI and output keep their constant in op1.sr
+        if (p->opcode == IR_LOADI || p->opcode == IR_OUTPUT) ops[i].a = p->op1.sr;
+    }
+    *len = n;
+    return ops;
+}
+
+void verify_capture(void) {
+    free(orig);
+    orig = snapshot(&orig_len, 0);
+}
+
+// a whole token as an int
+static int parse_int(const char *tok, int *v) {
+    char *end;
+    errno = 0;
+    long x = strtol(tok, &end, 10);
+    if (end == tok || *end != '\0' || errno || x < INT_MIN || x > INT_MAX) return 0;
+    *v = (int)x;
+    return 1;
+}
+
+// the "-i address v1 v2 ..." arguments on the //SIM INPUT: line. An
+// address the simulator would refuse (not a number, negative, not word
+// aligned, or leaving the values past the end of memory) or a value that
+// is not a number is an error, so a block is never verified on input it
+// did not get. Returns 0 on success, -1 after printing the error
+static int read_input(const char *filename, int *addr, int **vals, int *nvals) {
+    FILE *f = fopen(filename, "r");
+    char *line = NULL;
+    size_t cap = 0;
+    int lineno = 0, ok = 1;
+
+    *addr = 0;
+    *vals = NULL;
+    *nvals = 0;
+    if (!f) return 0;
+
+    while (getline(&line, &cap, f) > 0) {
+        lineno++;
+        char *s = strstr(line, "//SIM INPUT:");
+        if (!s) continue;
+
+        char *tok = strtok(s + 12, " \t\r\n");
+        if (tok && strcmp(tok, "-i") == 0 && (tok = strtok(NULL, " \t\r\n"))) {
+            if (!parse_int(tok, addr) || *addr < 0 || *addr >= VERIFY_MEMORY ||
+                *addr % 4 != 0) {
+                fprintf(stderr, "ERROR %d: //SIM INPUT address '%s' is not a word-aligned "
+                                "address in memory\n", lineno, tok);
+                ok = 0;
+                break;
+            }
+            int cap_vals = 16;
+            *vals = malloc(cap_vals * sizeof(int));
+            while ((tok = strtok(NULL, " \t\r\n"))) {
+                if (*nvals == cap_vals) {
+                    cap_vals *= 2;
+                    *vals = realloc(*vals, cap_vals * sizeof(int));
+                }
+                if (!parse_int(tok, &(*vals)[(*nvals)++])) {
+                    fprintf(stderr, "ERROR %d: //SIM INPUT value '%s' is not a valid number\n",
+                            lineno, tok);
+                    ok = 0;
+                    break;
+                }
+            }
+            if (ok && *addr / 4 + *nvals > MEM_WORDS) {
+                fprintf(stderr, "ERROR %d: //SIM INPUT values run past the end of memory at "
+                                "%d\n", lineno, VERIFY_MEMORY);
+                ok = 0;
+            }
+        }
+        break;
+    }
+
+    free(line);
+    fclose(f);
+    return ok ? 0 : -1;
+}
+
+static int latency(IROpcode op) {
+    return op == IR_LOAD ? LAT_LOAD : op == IR_STORE ? LAT_STORE : LAT_DEFAULT;
+}
+
+static inline int max2(int a, int b) {
+    return a > b ? a : b;
+}
+
+// interpret ops the way the lab 2 simulator does with every interlock on
+// (-s 3): one operation per cycle, in order, each waiting for the registers
+// and memory words it reads or writes to have no pending write. Since an
+// operation never issues past a pending write it depends on, effects can be
+// applied at issue and only their completion cycles need tracking. A
+// bundled op issues in the cycle of the op before it, as on the lab 3
+// machine, unless it has something of its own to wait for
+static void interpret(VOp *ops, int n, int nregs, int addr, int *vals, int nvals, VRun *r) {
+    int *reg = calloc(nregs, sizeof(int));
+    int *reg_ready = calloc(nregs, sizeof(int));
+    int *mem_ready = calloc(MEM_WORDS, sizeof(int));
+    int nout_cap = 16;
+    int cycle = 0, done = 0, issued = 0;
+
+    r->mem = calloc(MEM_WORDS, sizeof(unsigned));
+    r->written = calloc(MEM_WORDS, sizeof(char));
+    r->out = malloc(nout_cap * sizeof(int));
+    r->nout = 0;
+    r->failed = 0;
+
+    for (int i = 0; i < nvals; i++) r->mem[addr / 4 + i] = (unsigned)vals[i];
+
+    for (int i = 0; i < n && !r->failed; i++) {
+        VOp *o = &ops[i];
+        int t = o->bundled ? issued : cycle;
+        int w = -1;  // memory word read or written
+
+        switch (o->opcode) {
+            case IR_LOAD:
+            case IR_STORE: {
+                int a = o->opcode == IR_LOAD ? reg[o->a] : reg[o->c];
+                if (a % 4 != 0 || a < 0 || a >= VERIFY_MEMORY) {
+                    fprintf(stderr, "ERROR %d: %s of bad address %d\n", o->line,
+                            o->opcode == IR_LOAD ? "load" : "store", a);
+                    r->failed = 1;
+                    continue;
+                }
+                w = a / 4;
+                t = max2(t, max2(reg_ready[o->a], reg_ready[o->c]));
+                if (o->opcode == IR_LOAD) t = max2(t, mem_ready[w]);
+                break;
+            }
+            case IR_OUTPUT:
+                if (o->a % 4 != 0 || o->a < 0 || o->a >= VERIFY_MEMORY) {
+                    fprintf(stderr, "ERROR %d: output of bad address %d\n", o->line, o->a);
+                    r->failed = 1;
+                    continue;
+                }
+                w = o->a / 4;
+                t = max2(t, mem_ready[w]);
+                break;
+            case IR_LOADI:
+                t = max2(t, reg_ready[o->c]);
+                break;
+            case IR_NOP:
+                break;
+            default:
+                t = max2(t, max2(reg_ready[o->a], max2(reg_ready[o->b], reg_ready[o->c])));
+                break;
+        }
+
+        int lat = latency(o->opcode);
+        issued = t;
+        cycle = t + 1;
+        done = max2(done, t + lat);
+
+        switch (o->opcode) {
+            case IR_LOAD:
+                reg[o->c] = (int)r->mem[w];
+                reg_ready[o->c] = t + lat;
+                break;
+            case IR_LOADI:
+                reg[o->c] = o->a;
+                reg_ready[o->c] = t + lat;
+                break;
+            case IR_STORE:
+                r->mem[w] = (unsigned)reg[o->a];
+                r->written[w] = 1;
+                mem_ready[w] = t + lat;
+                break;
+            case IR_ADD:
+                reg[o->c] = (int)((unsigned)reg[o->a] + (unsigned)reg[o->b]);
+                reg_ready[o->c] = t + lat;
+                break;
+            case IR_SUB:
+                reg[o->c] = (int)((unsigned)reg[o->a] - (unsigned)reg[o->b]);
+                reg_ready[o->c] = t + lat;
+                break;
+            case IR_MULT:
+                reg[o->c] = (int)((unsigned)reg[o->a] * (unsigned)reg[o->b]);
+                reg_ready[o->c] = t + lat;
+                break;
+            case IR_LSHIFT:
+                reg[o->c] = (int)((unsigned)reg[o->a] << (reg[o->b] & 31));
+                reg_ready[o->c] = t + lat;
+                break;
+            case IR_RSHIFT:
+                reg[o->c] = reg[o->a] >> (reg[o->b] & 31);
+                reg_ready[o->c] = t + lat;
+                break;
+            case IR_OUTPUT:
+                if (r->nout == nout_cap) {
+                    nout_cap *= 2;
+                    r->out = realloc(r->out, nout_cap * sizeof(int));
+                }
+                r->out[r->nout++] = (int)r->mem[w];
+                break;
+            default:
+                break;
+        }
+    }
+
+    r->cycles = max2(cycle, done);
+    free(reg);
+    free(reg_ready);
+    free(mem_ready);
+}
+
+static void free_run(VRun *r) {
+    free(r->out);
+    free(r->mem);
+    free(r->written);
+}
+
+static inline int reg_ok(int r, int limit) {
+    return r >= 0 && r < limit;
+}
+
+// index of the first operation naming a register outside [0, limit), or -1
+static int check_regs(VOp *ops, int n, int limit) {
+    for (int i = 0; i < n; i++) {
+        int ok;
+        switch (ops[i].opcode) {
+            case IR_LOADI:
+                ok = reg_ok(ops[i].c, limit);
+                break;
+            case IR_LOAD:
+            case IR_STORE:
+                ok = reg_ok(ops[i].a, limit) && reg_ok(ops[i].c, limit);
+                break;
+            case IR_OUTPUT:
+            case IR_NOP:
+                ok = 1;
+                break;
+            default:
+                ok = reg_ok(ops[i].a, limit) && reg_ok(ops[i].b, limit) &&
+                     reg_ok(ops[i].c, limit);
+                break;
+        }
+        if (!ok) return i;
+    }
+    return -1;
+}
+
+int verify_allocation(const char *filename, int k) {
+    int addr, *vals, nvals;
+    int alloc_len, bad = 0;
+
+    if (!orig) {
+        fprintf(stderr, "ERROR: nothing captured to verify against\n");
+        return 1;
+    }
+
+    if (read_input(filename, &addr, &vals, &nvals) != 0) {
+        free(vals);
+        return 1;
+    }
+    VOp *alloc = snapshot(&alloc_len, 1);
+
+    int i = check_regs(alloc, alloc_len, k);
+    if (i != -1) {
+        fprintf(stderr, "Verify: allocated code for line %d names a register outside r0..r%d\n",
+                alloc[i].line, k - 1);
+        free(alloc);
+        free(vals);
+        return 1;
+    }
+
+    int nregs = 1;
+    for (int i = 0; i < orig_len; i++) {
+        nregs = max2(nregs, max2(orig[i].b, orig[i].c) + 1);
+        if (orig[i].opcode != IR_LOADI && orig[i].opcode != IR_OUTPUT)
+            nregs = max2(nregs, orig[i].a + 1);
+    }
+
+    VRun a, b;
+    interpret(orig, orig_len, nregs, addr, vals, nvals, &a);
+    interpret(alloc, alloc_len, k, addr, vals, nvals, &b);
+
+    if (a.failed || b.failed) {
+        fprintf(stderr, "Verify: the %s block stopped on an error\n",
+                a.failed ? "original" : "allocated");
+        bad++;
+    }
+
+    // every output, in order
+    int n = a.nout < b.nout ? a.nout : b.nout;
+    for (int i = 0; i < n; i++) {
+        if (a.out[i] != b.out[i] && bad++ < MAX_REPORTS)
+            fprintf(stderr, "Verify: output %d is %d, expected %d\n", i + 1, b.out[i], a.out[i]);
+    }
+    if (a.nout != b.nout && bad++ < MAX_REPORTS)
+        fprintf(stderr, "Verify: %d outputs, expected %d\n", b.nout, a.nout);
+
+    // final memory; the allocated block may also write its spill area
+    int spill_end = (SPILL_BASE + alloc_stats.slots * SPILL_WORD) / 4;
+    for (int w = 0; w < MEM_WORDS; w++) {
+        if (a.mem[w] == b.mem[w]) continue;
+        if (!a.written[w] && w >= SPILL_BASE / 4 && w < spill_end) continue;
+        if (bad++ < MAX_REPORTS)
+            fprintf(stderr, "Verify: memory[%d] is %d, expected %d\n", w * 4, (int)b.mem[w],
+                    (int)a.mem[w]);
+    }
+
+    if (bad > MAX_REPORTS)
+        fprintf(stderr, "Verify: %d more differences\n", bad - MAX_REPORTS);
+
+    verify_stats.outputs = a.nout;
+    verify_stats.orig_cycles = a.cycles;
+    verify_stats.alloc_cycles = b.cycles;
+
+    free_run(&a);
+    free_run(&b);
+    free(alloc);
+    free(vals);
+    return bad != 0;
+}
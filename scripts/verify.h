@@ -0,0 +1,25 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+// size of the simulated memory, as in the lab 2 simulator
+#define VERIFY_MEMORY 4000000
+
+typedef struct {
+    int outputs;        // values printed by each block
+    int orig_cycles;    // cycles for the block as written
+    int alloc_cycles;   // cycles for the allocated block
+} VerifyStats;
+
+extern VerifyStats verify_stats;
+
+// snapshot the block as written; call after parsing, before anything
+// renames, optimizes or allocates it
+void verify_capture(void);
+
+// run the snapshot and the allocated block on the //SIM INPUT values in
+// filename and compare their outputs and final memory; k bounds the
+// registers the allocated block may name. Returns 0 when they agree,
+// printing each difference to stderr otherwise
+int verify_allocation(const char *filename, int k);
+
+#endif
@@ -0,0 +1,4 @@
+// a load wholly past the end of memory names its own address
+//EXPECT: Simulator Error: Invalid memory address 5000000 accessed in cycle 1.
+	loadI	5000000	=> r1
+	load	r1	=> r2
@@ -0,0 +1,5 @@
+// a load whose word runs past the end names the first byte outside
+//FLAGS: -m 102
+//EXPECT: Simulator Error: Invalid memory address 102 accessed in cycle 1.
+	loadI	100	=> r1
+	load	r1	=> r2
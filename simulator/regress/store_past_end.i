@@ -0,0 +1,5 @@
+// a store past the end fails when it retires, on its highest byte
+//EXPECT: Simulator Error: Invalid memory address 4194303 accessed in cycle 4.
+	loadI	4194300	=> r1
+	loadI	7	=> r2
+	store	r2	=> r1
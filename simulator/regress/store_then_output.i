@@ -0,0 +1,7 @@
+// an output of a word with a bad store pending waits for the store, so
+// the store's fault is the one reported
+//EXPECT: Simulator Error: Invalid memory address 4194303 accessed in cycle 4.
+	loadI	4194300	=> r1
+	loadI	7	=> r2
+	store	r2	=> r1
+	output	4194300
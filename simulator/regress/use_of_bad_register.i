@@ -0,0 +1,7 @@
+// a read of a register past -r waits for the pending write to it, whose
+// fault is reported when it retires
+//FLAGS: -r 4
+//EXPECT: Simulator Error: Invalid register number r7 used in cycle 3.
+	loadI	1024	=> r0
+	load	r0	=> r7
+	add	r7, r7	=> r1
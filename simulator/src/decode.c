@@ -0,0 +1,102 @@
+/*  decode.c
+ *  Lowers a parsed block into a flat array of fixed-size operations
+ *  for the simulator's fast execute loop */
+
+#include <stdlib.h>
+#include "instruction.h"
+#include "machine.h"
+#include "sim.h"
+#include "decode.h"
+
+/* Returns 1 if reg names a register in the register bank */
+static int valid_register(int reg)
+{
+    return reg >= 0 && reg < NUM_REGISTERS;
+}
+
+/* Fill in d from op; returns 0 if op cannot be decoded */
+static int decode_operation(Operation* op, Decoded_Op* d)
+{
+    d->src1 = d->src2 = d->def = -1;
+    d->constant = 0;
+    d->line = op->line;
+    d->latency = opcode_specs[op->opcode].latency;
+
+    if (!permitted_opcode[op->opcode] || d->latency >= EFFECT_RING)
+	return 0;
+
+    switch(op->opcode)
+    {
+	case NOP:
+	  d->kind = D_NOP;
+	  return 1;
+
+	case ADD:    d->kind = D_ADD;    break;
+	case SUB:    d->kind = D_SUB;    break;
+	case MULT:   d->kind = D_MULT;   break;
+	case LSHIFT: d->kind = D_LSHIFT; break;
+	case RSHIFT: d->kind = D_RSHIFT; break;
+
+	case LOADI:
+	  d->kind = D_LOADI;
+	  d->constant = op->consts->value;
+	  d->def = op->defs->value;
+	  return valid_register(d->def);
+
+	case LOAD:
+	  d->kind = D_LOAD;
+	  d->src1 = op->srcs->value;
+	  d->def = op->defs->value;
+	  return valid_register(d->src1) && valid_register(d->def);
+
+	case STORE:
+	  d->kind = D_STORE;
+	  d->src1 = op->srcs->value;
+	  d->def = op->defs->value;
+	  return valid_register(d->src1) && valid_register(d->def);
+
+	case OUTPUT:
+	  d->kind = D_OUTPUT;
+	  d->constant = op->consts->value;
+	  return 1;
+
+	default:
+	  return 0;
+    }
+
+    /* the two-register arithmetic ops */
+    d->src1 = op->srcs->value;
+    d->src2 = op->srcs->next->value;
+    d->def = op->defs->value;
+    return valid_register(d->src1) && valid_register(d->src2) &&
+	valid_register(d->def);
+}
+
+Decoded_Op* decode_program(Instruction* code, int* count)
+{
+    Instruction* inst;
+    Decoded_Op* ops;
+    int n = 0;
+
+    for(inst=code;inst;inst=inst->next) {
+	if (!inst->operations || inst->operations->next)
+	    return NULL;
+	n++;
+    }
+
+    ops = (Decoded_Op*)malloc((n > 0 ? n : 1)*sizeof(Decoded_Op));
+    if (!ops)
+	return NULL;
+
+    n = 0;
+    for(inst=code;inst;inst=inst->next) {
+	if (!decode_operation(inst->operations,&ops[n])) {
+	    free(ops);
+	    return NULL;
+	}
+	n++;
+    }
+
+    *count = n;
+    return ops;
+}
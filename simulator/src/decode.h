@@ -0,0 +1,30 @@
+/*  decode.h
+ *  Lowers a parsed block into a flat array of fixed-size operations
+ *  for the simulator's fast execute loop */
+
+#ifndef _DECODE_H_
+#define _DECODE_H_
+
+#include "instruction.h"
+
+/* The operations the fast loop understands; the loop dispatches on these */
+typedef enum decoded_kind {D_NOP=0, D_ADD, D_SUB, D_MULT, D_LSHIFT, D_RSHIFT,
+			   D_LOADI, D_LOAD, D_STORE, D_OUTPUT} Decoded_Kind;
+
+/* One decoded operation.  Unused register fields hold -1.  A store keeps
+   the value in src1 and the address in def, as the parser does */
+typedef struct decoded_op {
+    Decoded_Kind kind;
+    int src1, src2, def;
+    int constant;
+    int latency;
+    int line;
+} Decoded_Op;
+
+/* Decode the block starting at code into an array of count operations.
+   Returns NULL if the block needs the general simulator: an instruction
+   with more than one operation, an opcode outside the lab 2 subset or not
+   permitted in this version, or a register outside the register bank */
+Decoded_Op* decode_program(Instruction* code, int* count);
+
+#endif /* _DECODE_H_ */
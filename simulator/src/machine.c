@@ -0,0 +1,172 @@
+/*  machine.c
+ *  Source code for low level operations used in a simulator for
+ *  the ILOC subset defined in
+ *  "Engineering a Compiler" by Cooper and Torczon
+ *  written by Todd Waterman
+ *  11/30/00 */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include "machine.h"
+
+int code_check;
+int code_check_flag;
+int cycle_count;
+
+jmp_buf* sim_abort = NULL;
+
+/* Initial contents of every register: 0xFEFEFEFE under the code check,
+   0 otherwise.  register_bank stores value ^ reg_fill, so the fill costs
+   nothing until a register is written */
+static int reg_fill;
+
+/* Shift of a byte within its word */
+#define BYTE_SHIFT(location) (24 - 8*((location) & 3))
+
+/* Large zero-filled arrays come straight from mmap.  calloc would do the
+   same for the first run, but once such a block is freed malloc raises its
+   mmap threshold and later callocs memset the whole array, which made
+   repeated runs in one process (simlib.c) pay for every byte again */
+void* zero_pages(size_t bytes)
+{
+    void* p = mmap(NULL,bytes ? bytes : 1,PROT_READ|PROT_WRITE,
+		   MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+void free_pages(void* p, size_t bytes)
+{
+    if (p)
+      munmap(p,bytes ? bytes : 1);
+}
+
+/* Initialize arrays used in the machine during the simulation.  Both banks
+   are untouched zero pages, so a short block only pays for the pages it
+   actually uses */
+void initialize_machine(int reg_size, int mem_size)
+{
+    if (reg_size == 0)
+	NUM_REGISTERS = DEFAULT_NUM_REGISTERS;
+    else 
+	NUM_REGISTERS = reg_size;
+
+    if (mem_size == 0)
+	MEMORY_SIZE = DEFAULT_MEMORY_SIZE;
+    else
+	MEMORY_SIZE = mem_size;
+
+    reg_fill = code_check ? 0xFEFEFEFE : 0;
+
+    register_bank = (int*)zero_pages(NUM_REGISTERS*sizeof(int));
+    memory_bank = (unsigned int*)zero_pages(((MEMORY_SIZE+3)/4)*sizeof(unsigned int));
+    if (!register_bank || !memory_bank) {
+      fprintf(stderr,"Simulator Error: could not allocate %d registers and %d bytes of memory.\n",
+	      NUM_REGISTERS,MEMORY_SIZE);
+      sim_exit(1);
+    }
+}
+
+void free_machine(void)
+{
+    free_pages(register_bank,NUM_REGISTERS*sizeof(int));
+    free_pages(memory_bank,((MEMORY_SIZE+3)/4)*sizeof(unsigned int));
+    register_bank = NULL;
+    memory_bank = NULL;
+}
+
+void sim_exit(int code)
+{
+    if (sim_abort)
+      longjmp(*sim_abort,code ? code : 1);
+    exit(code);
+}
+
+/* Reports an access outside of memory */
+static void __attribute__((noreturn)) bad_address(int location)
+{
+    fprintf(stderr,"Simulator Error: Invalid memory address %d accessed in cycle %d.\n", 
+	    location,cycle_count);
+    sim_exit(1);
+}
+
+/* The first byte of the word at location that falls outside memory, the
+   one the byte-at-a-time version reported as it went from low to high */
+static int first_bad_byte(int location)
+{
+    return location < 0 || location >= MEMORY_SIZE ? location : MEMORY_SIZE;
+}
+
+/* These functions allow word (integer) access to memory, a word of memory
+   is assumed to be 4 bytes */
+int get_word(int location)
+{
+  if ((location %4) != 0) {
+    fprintf(stderr,"Simulator error: attempt to read an unaligned word.\n");
+    sim_exit(-1);
+  }
+
+  if (location < 0 || location > MEMORY_SIZE - 4)
+    bad_address(first_bad_byte(location));
+  return (int)memory_bank[location >> 2];
+}
+
+void set_word(int location, int value) {
+  if ((location %4) != 0) {
+    fprintf(stderr,"Simulator error: attempt to set an unaligned word.\n");
+    sim_exit(-1);
+  }
+
+  if (location < 0 || location > MEMORY_SIZE - 4)
+    bad_address(first_bad_byte(location));
+  memory_bank[location >> 2] = (unsigned int)value;
+}
+
+
+/* The following functions manage access to the register and memory banks,
+   this prevents the simulator from crashing if the input program uses an 
+   invalid memory address or register name */
+
+int get_register(int reg)
+{
+    if (reg >= 0 && reg < NUM_REGISTERS)
+	return register_bank[reg] ^ reg_fill;
+    
+    fprintf(stderr,"Simulator Error: Invalid register number r%d used in cycle %d.\n", 
+	    reg,cycle_count);
+    sim_exit(1);
+}
+	
+void set_register(int reg, int value)
+{
+  if (reg >= 0 && reg < NUM_REGISTERS) {
+    if (code_check && register_bank[reg] != 0)
+      code_check_flag++;
+    register_bank[reg] = value ^ reg_fill;
+  }
+  else
+  {
+    fprintf(stderr,
+	    "Simulator Error: Invalid register number r%d used in cycle %d.\n",            reg,cycle_count);
+    sim_exit(1);
+  }
+}
+
+
+char get_memory(int location)
+{
+    if (location < 0 || location >= MEMORY_SIZE)
+	bad_address(location);
+    return (char)(memory_bank[location >> 2] >> BYTE_SHIFT(location));
+}
+
+void set_memory(int location,char value)
+{
+    unsigned int shift;
+
+    if (location < 0 || location >= MEMORY_SIZE)
+	bad_address(location);
+    shift = BYTE_SHIFT(location);
+    memory_bank[location >> 2] = (memory_bank[location >> 2] & ~(0xFFu << shift)) |
+	((unsigned int)(unsigned char)value << shift);
+}
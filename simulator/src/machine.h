@@ -0,0 +1,59 @@
+/*  machine.h
+ *  Header file for low level operations used in a simulator for
+ *  the ILOC subset defined in
+ *  "Engineering a Compiler" by Cooper and Torczon
+ *  written by Todd Waterman
+ *  11/30/00 */
+
+#ifndef _MACHINE_H_
+#define _MACHINE_H_
+
+#include <setjmp.h>
+#include <stddef.h>
+
+/* The default number of bytes of addressable memory starting from 0 */
+#define DEFAULT_MEMORY_SIZE 4000000
+int MEMORY_SIZE;
+
+/* The default number of registers */
+#define DEFAULT_NUM_REGISTERS 1000000
+int NUM_REGISTERS;
+
+/* Array of registers; each entry holds its value xor'ed with the
+   initial register contents, so a zero-filled bank reads as initialized */
+int* register_bank;
+
+/* Main memory, one 32-bit word per 4 bytes.  Bytes within a word are
+   numbered from the most significant end, as ILOC stores them */
+unsigned int* memory_bank;
+
+/* Initialize arrays used in the machine representation during the 
+   simulation */
+void initialize_machine(int reg_size, int mem_size);
+
+/* Zero-filled memory that costs nothing until it is touched */
+void* zero_pages(size_t bytes);
+void free_pages(void* p, size_t bytes);
+
+/* Release the register and memory banks */
+void free_machine(void);
+
+/* Ends the simulation after an error.  The stand-alone simulator exits;
+   when sim_abort is set (by sim_run() in simlib.c) it jumps there instead */
+extern jmp_buf* sim_abort;
+void sim_exit(int code) __attribute__((noreturn));
+
+/* These functions allow word (integer) access to memory, a word of memory
+   is assumed to be 4 bytes */
+int get_word(int);
+void set_word(int,int);
+
+/* The following functions manage access to the register and memory banks,
+   this prevents the simulator from crashing if the input program uses an 
+   invalid memory address or register name */
+int get_register(int);
+void set_register(int,int);
+char get_memory(int);
+void set_memory(int,char);
+
+#endif /* _MACHINE_H_ */   
@@ -0,0 +1,1889 @@
+/*  sim.c
+ *  Source code for a simulator of the ILOC subset defined in
+ *  "Engineering a Compiler" by Cooper and Torczon
+ *  written by Todd Waterman
+ *  11/30/00 */
+
+/* modified to add tracing and word-alignment check on load & store 
+ * -- kdc, Fall 2014
+ */
+
+/* modified to check for a zero length file and print an intuitive 
+ * message because the normal endfile message confuses the students
+ * -- kdc, December 2023
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "instruction.h"
+#include "machine.h"
+#include "sim.h"
+#include "decode.h"
+
+static int first_op = 0;
+
+static int memory_op_count;
+static int mult_op_count;
+static int op_count;
+static int output_op_count;
+static int branch_op_count;
+
+static void complain_and_die(char *op);
+static void die_quickly(int code);
+
+#ifndef SIM_LIBRARY
+static int  IntFromString(char *p, int *l);
+static int  FileCopy(FILE *out, FILE *in);
+#endif
+
+/* Pending effects, bucketed by the cycle in which they take effect.
+ * Each bucket is a FIFO, so effects due in the same cycle are applied in
+ * the order they were issued, as with the old single list. */
+static Change* ring_head[EFFECT_RING];
+static Change* ring_tail[EFFECT_RING];
+static int pending_effects = 0;
+static int pending_branches = 0;
+
+/* Scoreboard: the first cycle in which each register or byte of memory
+ * has no pending write.  Zero means it was never written. */
+static int* reg_ready_cycle;
+static int* mem_ready_cycle;
+
+/* Pending writes to registers or bytes outside the machine.  The first
+ * one to take effect stops the run, so there are only ever a few, but
+ * until then they stall readers of the same location, as they did when
+ * every check walked the pending list. */
+typedef struct {
+    Effect_Type type;
+    int location;
+    int ready;
+} Wild_Write;
+
+static Wild_Write* wild = NULL;
+static int wild_count = 0;
+static int wild_cap = 0;
+
+static void note_wild(Effect_Type type, int location, int ready);
+static int wild_ready(Effect_Type type, int location);
+
+/* Change records are recycled through a free list rather than going back
+ * to malloc for every effect; CHANGE_BLOCK records are carved at a time. */
+#define CHANGE_BLOCK 256
+static Change* free_changes = NULL;
+
+static Change* new_change(void);
+static void free_change(Change*);
+static Decoded_Op* decoded = NULL;
+
+/* Stall profile: interlock cycles charged to each source line, grown
+ * as higher lines stall */
+static int* reg_stalls = NULL;
+static int* mem_stalls = NULL;
+static int profile_lines = 0;
+
+static void count_stall(int line, int memory);
+static void profile_stall(Instruction* inst);
+
+static void store_bytes(int location, int value);
+static void simulate_decoded(Decoded_Op* ops, int count,
+			     int* instruction_count, int* operation_count);
+
+#ifndef SIM_LIBRARY
+static FILE *tempfile = NULL;
+static FILE *datafile = NULL;
+#endif
+static char filename[128];
+static int DataFileName = 0;
+
+/* three values shared with machine.c */
+int code_check;        /* 1 => we are doing the code check */
+int code_check_flag;   /* counts number of violations */
+int cycle_count;
+
+#ifndef SIM_LIBRARY
+int main(int argc, char* argv[]) {
+  int mem_size = DEFAULT_MEMORY_SIZE;
+  int reg_size = DEFAULT_NUM_REGISTERS;
+  int current_argument = 1;
+  int machine_initialized = 0;
+  int start_location;
+
+  int temp;  /* used in string to integer conversions */
+  int legal;
+
+  int seen_r = 0;
+  int seen_m = 0;
+  int seen_file = 0;
+  int file_size = 0;
+  
+  Instruction* code;
+  char *c;
+  char *p;
+
+  /* Set default stall mode - branches and memory */
+  set_stall_mode(3);  /* default for Lab 2 is stall mode 1 */
+
+  tracing = 0;
+  code_check = 0;
+  code_check_flag = 0;
+  cycle_count = 0;    
+
+  while(current_argument < argc) {
+
+    c = argv[current_argument];
+
+    if (*c != '-') {
+      if (seen_file == 0) {
+	seen_file = current_argument;
+	fclose(stdin);
+	stdin = fopen(argv[current_argument],"r");
+	if (stdin == NULL) {
+	  fprintf(stderr,"Error: could not open file '%s' for input.\n\n",
+		  argv[current_argument]);
+	  exit(-1);  // not die_quickly because it closes stdin
+	}
+	else { /* check for an empty file & print useful message */
+	  fseek(stdin, 0L, SEEK_END);
+	  file_size = ftell(stdin);
+	  // fprintf(stderr,"==> file size is %d bytes\n",file_size);
+	  if (file_size < 1) {
+	    fprintf(stderr,"Error: \tFile passed to the simulator is empty.\n\n");
+	    fprintf(stderr,"\tIn a test script, an empty file usually indicates that\n");
+	    fprintf(stderr,"\tthe component under test terminated in an abnormal way.\n\n");
+	    die_quickly(-1);
+	    
+	  }
+	  rewind(stdin); /* then, move file pointer back to start */
+	}
+      }
+      else {
+	fprintf(stderr,
+		"\nError: invalid command-line argument ('%s').\n",
+		argv[current_argument]);
+	die_quickly(-1);
+      }
+      current_argument++;
+    }
+    else {
+      c++;
+
+      if (*c == 'h') {
+	print_help();
+	return 0;
+      } 
+      else if (*c == 't') {
+	tracing++;
+	current_argument += 1;
+      }
+      else if (*c == 'v') {
+	fprintf(stdout,"ILOC Simulator, Version %s: %d-%d\n", CLASS,
+		MAJOR_VERSION, MINOR_VERSION);
+	current_argument += 1;
+      }
+      else if (*c == 'x') {
+	fprintf(stdout,"COMP 412, Lab 2 Code Check:\n");
+	code_check++;
+        current_argument += 1;
+      }
+      else { /* All of the following flags require at least one additional 
+		parameter, so perform check here. */
+	if (current_argument == argc - 1) {
+	  fprintf(stderr,"Invalid flag sequence: ");
+	  fprintf(stderr,"make sure any required numbers are included.\n");
+	  return(1);
+	}
+      
+	if (*c == 'r') {
+	  if (machine_initialized) {
+	    fprintf(stderr,"\nError: -r must precede -i and -c.\n");
+	    die_quickly(-1);
+	  }
+
+	  if (seen_r) {
+	    fprintf(stderr,"Argument error: only one -r allowed.\n");
+	    return 0;
+	  }
+	  else 
+	    seen_r++;
+
+	  temp  = IntFromString(argv[current_argument+1],&legal);
+	  if (legal)
+	    reg_size = temp;
+	  else {
+	    fprintf(stderr,"\nError: argument to -r ('%s') is not a valid number.\n",
+		    argv[current_argument+1]);
+	    fprintf(stderr,"execution halts.\n\n");
+	    die_quickly(-1);
+	  }
+	  
+	  current_argument += 2;
+	}
+	else if (*c == 'm') {
+	  if (machine_initialized) {
+	    fprintf(stderr,"\nError: -m must precede -i and -c.\n");
+	    die_quickly(-1);
+	  }
+
+	  if (seen_m) {
+	    fprintf(stderr,"Argument error: only one -m allowed.\n");
+	    return 0;
+	  }
+	  else 
+	    seen_m++;
+
+	  temp  = IntFromString(argv[current_argument+1],&legal);
+	  if (legal)
+	    mem_size = temp;
+	  else {
+	    fprintf(stderr,"\nError: argument to -m ('%s') is not a valid number.\n",
+		    argv[current_argument+1]);
+	    fprintf(stderr,"execution halts.\n\n");
+	    die_quickly(-1);
+	  }
+	  
+	  current_argument += 2;
+	}
+	else if (*c == 's') {
+	  temp  = IntFromString(argv[current_argument+1],&legal);
+	  if (!legal) {
+	    fprintf(stderr,"\nError: argument to -m ('%s') is not a valid number.\n",
+		    argv[current_argument+1]);
+	    fprintf(stderr,"execution halts.\n\n");
+	    die_quickly(-1);
+	  }
+	  else if (1 > temp || temp > 3) {
+	    fprintf(stderr,"\nError: stall mode must be 1, 2, or 3.\n");
+	    fprintf(stderr,"Execution halts.\n\n");
+	    die_quickly(-1);
+	  }
+
+	  set_stall_mode(temp);
+	  current_argument += 2;
+	}
+	else if (*c == 'p') {
+	  profiling = current_argument+1;
+	  current_argument += 2;
+	}
+	else if (*c == 'd') {
+	  if (DataFileName > 0) {
+	    fprintf(stderr,"\nError: multiple data options on this command line.\n");
+	    fprintf(stderr,"Only one allowed.\n");
+	    fprintf(stderr,"Execution halts.\n");
+	    die_quickly(-1);
+	  }
+
+	  DataFileName = current_argument+1;
+	  current_argument += 2;
+	}
+	else if (*c == 'i') {
+	  start_location = IntFromString(argv[current_argument+1],&legal);
+	  
+	  if (!legal) {
+	    fprintf(stderr,
+		    "\nError: start location in -i is not a valid number ('%s')\n",
+		    argv[current_argument+1]);
+	    fprintf(stderr,"Execution halts.\n");
+	    die_quickly(-1);
+	  }
+	
+	  if (0 > start_location || start_location > mem_size - 1) {
+	    fprintf(stderr,
+		    "\nError: start address in -i option (%d) is out of range.\n",
+		    start_location);
+	    fprintf(stderr,"Current memory size is %d.\n\n",mem_size);
+	    fprintf(stderr,"Execution halts.\n");
+	    die_quickly(-1);
+	  }
+	  else if ((start_location % 4) != 0) {
+	    fprintf(stderr,
+		    "\nError: start address in -i option (%d) is not word aligned.\n",
+		    start_location);
+	    fprintf(stderr,"Execution halts.\n");
+	    die_quickly(-1);
+	  }
+	  if (!machine_initialized) {
+	    initialize_machine(reg_size,mem_size);
+	    machine_initialized = 1;
+	  }
+
+	  current_argument += 2;
+	  temp = IntFromString(argv[current_argument],&legal);
+
+	  while(legal) {
+	    set_word(start_location,temp);
+	    start_location += 4;
+	    current_argument++;
+	    if (current_argument == argc)
+	      legal = 0;
+	    else
+	      temp = IntFromString(argv[current_argument],&legal); 
+	  }
+
+	}
+	else if (*c == 'c') {
+	  char c;
+	  start_location = IntFromString(argv[current_argument+1],&legal);
+	  
+	  if (!legal) {
+	    fprintf(stderr,
+		    "\nError: start location in -c is not a valid number ('%s')\n",
+		    argv[current_argument+1]);
+	    fprintf(stderr,"Execution halts.\n");
+	    die_quickly(-1);
+	  }
+	
+	  if (0 > start_location || start_location > mem_size - 1) {
+	    fprintf(stderr,
+		    "\nError: start address in -c option (%d) is out of range.\n",
+		    start_location);
+	    fprintf(stderr,"Current memory size is %d.\n\n",mem_size);
+	    fprintf(stderr,"Execution halts.\n");
+	    die_quickly(-1);
+	  }
+
+	  if (!machine_initialized) {
+	    initialize_machine(reg_size,mem_size);
+	    machine_initialized = 1;
+	  }
+
+	  current_argument += 2;
+	  
+	  // fprintf(stderr,"\nMEM[%d ff] <-",start_location);
+
+	  legal = 1;
+	  while(legal) {
+	    if (strlen(argv[current_argument]) == 1) {
+	      c = *argv[current_argument];
+	      fprintf(stderr," %c",c);
+	      set_memory(start_location,c);
+	      start_location++;
+	      current_argument++;
+	      if (current_argument == argc)
+		legal = 0;
+	    }
+	    else
+	      legal = 0;
+	  }
+	  // fprintf(stderr,"\n\n");
+	}
+	else {
+	  fprintf(stderr,"Invalid flag specified\n");
+	  return 0;
+	}
+      }
+    }
+  }
+
+  /* deferred processing from first '-d' on command line */
+  if (DataFileName > 0) {
+    sprintf(filename,"%s/IlocSim.XXXXXX",TEMPDIR);
+    p = mkdtemp(filename);
+      
+    tempfile = fopen(p,"w");
+    if (tempfile == NULL) {
+      fprintf(stderr,"\nError: could not open temporary file '%s'.\n",filename);
+      fprintf(stderr,"Data directive fails.\n");
+      die_quickly(-1);
+    }
+
+    datafile = fopen(argv[DataFileName],"r");
+    if (datafile == NULL) {
+      fprintf(stderr,"\nError: could not open data file '%s'.\n",
+	      argv[DataFileName]);
+      fprintf(stderr,"Data directive fails.\n");
+      die_quickly(-1);
+    }
+ 
+    if (FileCopy(tempfile,datafile) < 1) {
+      fprintf(stderr,"Warning: no lines in data file '%s'.\n",
+	      argv[DataFileName]);
+    }
+    fclose(datafile);
+    
+    FileCopy(tempfile,stdin);  /* append stdin to the temp file */
+    fclose(tempfile);
+    fclose(stdin);
+
+    stdin = fopen(filename,"r");
+    if (stdin == NULL) {
+      fprintf(stderr,"\nError: file open failure in data option.\n");
+      fprintf(stderr,"Execution halts.\n");
+      die_quickly(-1);
+    }
+  }
+
+  
+  if (!machine_initialized) 
+    initialize_machine(reg_size,mem_size);
+  
+  code = parse();
+
+  if (!code) {
+    fprintf(stderr,"\nError reading input file, simulator not run.\n");
+    return 1;
+  }
+
+  simulate(code);
+
+  if (profiling && !write_stall_profile(argv[profiling])) {
+    fprintf(stderr,"\nError: could not write stall profile '%s'.\n",
+	    argv[profiling]);
+    die_quickly(-1);
+  }
+
+  if (DataFileName > 0) {
+    fclose(stdin);
+    (void) remove(filename);
+  }
+
+  if (code_check) {
+    if (code_check_flag == 0)
+      fprintf(stdout,"Code Check: passed.\n");
+    else
+      fprintf(stdout,"Code Check: failed, with %d reassignments.\n",
+	      code_check_flag);
+  }
+  
+  return 0;
+};
+
+/* Print a usage message */
+void print_help()
+{
+    printf("Usage: sim [options] [filename]\n");
+    printf("  Options:\n");
+    printf("    -h                 display usage message\n");
+    printf("    -d datafile        prepends the contents of 'datafile' to the code\n");
+    printf("    -m NUM             simulator has NUM bytes of memory\n");
+    printf("    -r NUM             simulator has NUM available registers\n");
+    printf("    -s NUM             simulator stalls for the following conditions:\n");
+    printf("                         0:  nothing\n");
+    printf("                         1:  branches\n");
+    printf("                         2:  branches and memory interlocks\n");
+    printf("                         3:  branches and both register and memory interlocks\n");
+    printf("                         default setting is -s 3\n");
+    printf("    -p file            write the register and memory interlock cycles\n");
+    printf("                         of each source line to 'file'\n");
+    printf("    -t                 print a trace of simulator execution\n");
+    printf("    -v                 print the simultor's version number\n\n");
+    printf("    -i NUM ... NUM     starting at the memory location specified by the first\n");
+    printf("                         NUM put the remaining NUMs into memory as words.\n");
+    printf("                         Must be the last option specified\n");
+    printf("    -c NUM ... NUM     same as -i, but puts the NUMs into memory as bytes\n\n");
+    printf("  filename should be a valid ILOC input file.\n");
+    printf("  If filename is omitted, sim reads from stdin.\n\n");
+    printf("  Note: any use of -r or -m must precede any use of -i or -c.\n");
+    printf("  The -i and -c options initialize the simulator's memory.\n"); 
+    printf("  After that point, -r and -m no longer have an effect.\n");
+}
+#endif /* SIM_LIBRARY */
+
+/* Set stall flags appropriately */
+void set_stall_mode(int mode)
+{
+    stall_on_branches = 0;
+    stall_on_memory = 0;
+    stall_on_registers = 0;
+
+    switch(mode)
+    {
+	case 3:
+	  stall_on_registers = 1;
+	case 2:
+	  stall_on_memory = 1;
+	case 1:
+	  stall_on_branches = 1;
+	case 0:
+	  break;
+	default:
+	  fprintf(stderr,"Illegal safety mode specified.\n");
+	  die_quickly(-1);
+      }
+}
+
+
+/* Simulate the code and output results to standard out */
+void simulate(Instruction* code)
+{
+    Change* new_effects;
+    int decoded_count;
+    int instruction_count = 0;
+    int operation_count = 0;
+
+    reg_ready_cycle = (int*)zero_pages(NUM_REGISTERS*sizeof(int));
+    mem_ready_cycle = (int*)zero_pages(MEMORY_SIZE*sizeof(int));
+    if (!reg_ready_cycle || !mem_ready_cycle) {
+      fprintf(stderr,"Simulator Error: could not allocate the scoreboard.\n");
+      exit(1);
+    }
+
+    if (tracing) {
+      fprintf(stdout, "ILOC Simulator, Version %s-%d-%d\n",
+	      CLASS,MAJOR_VERSION,MINOR_VERSION);
+      fprintf(stdout,"Interlock settings: ");
+      if (stall_on_memory)
+	fprintf(stdout,"memory ");
+      if (stall_on_registers)
+	fprintf(stdout,"registers ");
+      if (stall_on_branches)
+	fprintf(stdout,"branches ");
+      if (! (stall_on_memory || stall_on_registers || stall_on_branches))
+	fprintf(stdout,"no hardware stalls ");
+      fprintf(stdout,"\n\n");
+    }
+
+    /* Straight-line blocks in the lab 2 subset run through the decoded
+       loop; traces and everything else take the general path below */
+    if (!tracing && (decoded = decode_program(code,&decoded_count))) {
+      simulate_decoded(decoded,decoded_count,&instruction_count,&operation_count);
+      free(decoded);
+      decoded = NULL;
+      code = NULL;
+    }
+
+    while(code)
+    {
+        if (tracing) {
+	  fprintf(stdout,"%d:\t[",cycle_count);
+	  first_op = 1;
+	}
+
+	if (!((memory_stall(code) && stall_on_memory) ||
+	      (register_stall(code) && stall_on_registers) ||
+	      (branch_stall() && stall_on_branches) ||
+	      (antidependence_stall(code) && stall_on_registers)))
+	{
+	    memory_op_count = 0;
+	    mult_op_count = 0;
+	    op_count = 0;
+	    output_op_count = 0;
+	    branch_op_count = 0;
+         
+	    new_effects = execute_instruction(code,&operation_count);
+
+	    /* checks restrictions on FU use */
+#ifdef LAB3
+	    if (op_count > 2 || memory_op_count > 1 || mult_op_count > 1 ||
+		output_op_count > 1 || branch_op_count > 1 ) {
+#endif
+#ifdef LAB1
+           if (op_count > 1) {
+#endif
+	        fprintf(stderr,"\nError: Machine constraints violated in cycle %d.\n\n",
+			cycle_count);
+		if (tracing)
+		  fprintf(stdout,"]\n");
+		else
+		  fprintf(stdout,"\n");
+		fflush(stdout);
+		die_quickly(-1);
+	    }
+		
+	    instruction_count++;
+
+	    schedule_changes(new_effects);
+
+	    /* Go to next instruction */
+	    code = code->next;
+	}
+        else {
+	  if (profiling)
+	    profile_stall(code);
+	  if (tracing)
+	    fprintf(stdout," stall ");
+	}
+	
+        if (tracing)
+	  fprintf(stdout,"]");
+	execute_changes(&code);
+	cycle_count++;
+	if (tracing)
+	  fprintf(stdout,"\n");
+
+    }
+
+    while(pending_effects)
+    {
+	execute_changes(&code);
+	cycle_count++;
+    }
+
+    instructions_executed = instruction_count;
+    operations_executed = operation_count;
+    if (!output_hook)
+      fprintf(stdout,"\nExecuted %d instructions and %d operations in %d cycles.\n",
+	      instruction_count,operation_count,cycle_count);
+
+}
+
+/* Charges one stalled cycle to a source line */
+static void count_stall(int line, int memory)
+{
+    int size;
+
+    if (line >= profile_lines) {
+      size = profile_lines ? profile_lines : 1024;
+      while (size <= line)
+	size *= 2;
+      reg_stalls = (int*)realloc(reg_stalls,size*sizeof(int));
+      mem_stalls = (int*)realloc(mem_stalls,size*sizeof(int));
+      if (!reg_stalls || !mem_stalls) {
+	fprintf(stderr,"Simulator Error: could not grow the stall profile.\n");
+	exit(1);
+      }
+      memset(reg_stalls+profile_lines,0,(size-profile_lines)*sizeof(int));
+      memset(mem_stalls+profile_lines,0,(size-profile_lines)*sizeof(int));
+      profile_lines = size;
+    }
+
+    if (memory)
+      mem_stalls[line]++;
+    else
+      reg_stalls[line]++;
+}
+
+/* Attributes a stalled cycle of the general loop the way simulate()
+   tests for it: memory first, then registers.  Branch stalls belong
+   to no line and are not counted */
+static void profile_stall(Instruction* inst)
+{
+    if (memory_stall(inst) && stall_on_memory)
+      count_stall(inst->line,1);
+    else if ((register_stall(inst) || antidependence_stall(inst)) &&
+	     stall_on_registers)
+      count_stall(inst->line,0);
+}
+
+int write_stall_profile(char* name)
+{
+    FILE* out = fopen(name,"w");
+    int line;
+
+    if (!out)
+      return 0;
+
+    fprintf(out,"// stall profile: line register-cycles memory-cycles\n");
+    for (line=0;line<profile_lines;line++)
+      if (reg_stalls[line] || mem_stalls[line])
+	fprintf(out,"%d %d %d\n",line,reg_stalls[line],mem_stalls[line]);
+
+    return fclose(out) == 0;
+}
+
+/* Returns 1 if the instruction uses a register that is not ready */
+int register_stall(Instruction* inst)
+{
+    Operation* current_op = inst->operations;
+
+    while(current_op)
+    {
+	/* Check source registers for operation */
+	if (!list_of_operands_ready(current_op->srcs))
+	    return 1;
+
+	/* Also check target registers on stores */
+	if ((opcode_specs[current_op->opcode].target_is_source) &&
+	    (!list_of_operands_ready(current_op->defs)))
+	    return 1;
+
+	current_op = current_op->next;
+    }
+
+    /* All registers are ready if this point is reached */
+    return 0;
+}
+
+/* Returns 1 if some register defined in the instruction is */
+/* already pending in the effects list 'changes' */
+/* 2014 Fix applied by KDC */
+int antidependence_stall(Instruction *inst) {
+
+  Operation *op = inst->operations;
+  Operand   *def;
+
+  while(op) {
+    def = op->defs;
+    while(def) {
+      if (!reg_ready(def->value))
+	return 1;
+      def = def->next;
+    }
+    op  = op->next;
+  }
+
+  return 0;
+}
+
+/* Returns 1 if all operands in the list are ready, and 
+   return 0 if they are not */
+int list_of_operands_ready(Operand* reg)
+{
+    while(reg)
+    {
+	/* Non zero values in register_ready indicate that
+	   the register is not ready */
+	if (!reg_ready(reg->value))
+	    return 0;
+	reg = reg->next;
+    }
+    
+    /* All register are ready if this point is reached */
+    return 1;
+}
+
+/* Returns 1 if the instruction uses a memory address that is not ready */
+int memory_stall(Instruction* inst)
+{
+    int memory_location;
+    Operation* current_op = inst->operations;
+
+    while(current_op)
+    {
+	switch(current_op->opcode)
+	{
+	    case LOAD:
+	    memory_location = get_register(current_op->srcs->value);
+	    if (!word_ready(memory_location))
+		return 1;
+	    break;
+
+	    case LOADAI:
+	    memory_location = get_register(current_op->srcs->value) +
+		current_op->consts->value;
+	    if (!word_ready(memory_location))
+		return 1;
+	    break;
+	    
+	    case LOADAO:
+	    memory_location = get_register(current_op->srcs->value) +
+		get_register(current_op->srcs->next->value);
+	    if (!word_ready(memory_location))
+		return 1;
+	    break;
+	    
+	    case CLOAD:
+	    memory_location = get_register(current_op->srcs->value);
+	    if (!mem_ready(memory_location))
+		return 1;
+	    break;
+	    
+	    case CLOADAI:
+	    memory_location = get_register(current_op->srcs->value) +
+		current_op->consts->value;
+	    if (!mem_ready(memory_location))
+		return 1;
+	    break;
+
+	    case CLOADAO:
+	    memory_location = get_register(current_op->srcs->value) +
+		get_register(current_op->srcs->next->value);
+	    if (!mem_ready(memory_location))
+		return 1;
+	    break;
+
+	    case OUTPUT:
+	    memory_location = current_op->consts->value;
+	    if (!mem_ready(memory_location)) /* mem_ready or word_ready ? */
+		return 1;
+	    break;
+
+
+	    default:
+	    break;
+	
+	}
+
+	current_op = current_op->next;
+    }
+    /* All memory locations are ready if this point is reached */
+    return 0;
+}
+
+/* Returns 1 if no pending effect writes the register */
+int reg_ready(int reg)
+{
+    if (reg < 0 || reg >= NUM_REGISTERS)
+	return wild_ready(REGISTER,reg);
+    return cycle_count >= reg_ready_cycle[reg];
+}
+
+/* Returns 1 if no pending effect writes the memory location */
+int mem_ready(int location)
+{
+    if (location < 0 || location >= MEMORY_SIZE)
+	return wild_ready(MEMORY,location);
+    return cycle_count >= mem_ready_cycle[location];
+}
+
+/* Returns 1 if no pending effect writes the word of memory */
+int word_ready(int location)
+{
+    int i;
+
+    for(i=0;i<4;i++)
+	if (!mem_ready(location+i))
+	    return 0;
+    return 1;
+}
+
+/* Execute all operations in a single instruction */
+Change* execute_instruction(Instruction* inst, int* op_count)
+{
+    Operation* current_op = inst->operations;
+    Change* all_changes = NULL;
+    Change* last_change;
+    Change* new_changes;
+
+    while(current_op)
+    {
+	(*op_count)++;
+	new_changes = execute_operation(current_op);
+	
+	if (!all_changes)
+	{
+	    all_changes = new_changes;
+	    last_change = new_changes;
+	}
+	else
+	    last_change->next = new_changes;
+
+	/* Move last change to end */
+	if (last_change)
+	    while(last_change->next)
+		last_change = last_change->next;
+		
+	current_op = current_op->next;
+    }
+
+    return(all_changes);
+}
+
+/* tracing routines -- kdc */
+
+/* Next steps:
+ * - expand trace operation to show source registers and target reg & value
+ * - show register number or memory location in a delayed effect
+ * - handle semicolons correctly
+ * - think about a bulk initialization for RAM
+ * 
+ * 
+ * 
+ */
+static char tr_buf[16], tr_string[256];
+static int last_traced_op = -1;
+static int last_traced_effect = -1;
+
+static char *StringFromInt( int num ) {
+  sprintf(tr_buf,"%d",num);
+  return tr_buf;
+}
+
+static void trace_operation( char * name, char *value ) {
+  if (tracing) {
+    if (last_traced_op != cycle_count) {
+      last_traced_op = cycle_count;
+      last_traced_effect = -1;
+    }
+
+    if (first_op == 1) {
+      fprintf(stdout,"%s %s",name,value);
+      first_op = 0;
+    }
+    else 
+      fprintf(stdout,"; %s %s",name,value);
+  }
+}
+
+static void trace_effect( int issued ) {
+  if (tracing) {
+    if (last_traced_effect != issued) 
+      fprintf(stdout," *%d",issued);
+
+    last_traced_effect = issued;
+  }
+}
+
+static char *immed_string( int c1, int r2, int value ) {
+  sprintf(tr_string,"%d => r%d (%d)",c1,r2,value);
+  return tr_string;
+}
+
+static char *addi_string( int r1, int r2, int r3, int value ) {
+  sprintf(tr_string,"r%d (%d), %d => r%d (%d)",r1,get_register(r1),r2,r3,value);
+  return tr_string;
+}
+
+static char *store_string( int r1, int r2, int value ) {
+  sprintf(tr_string,"r%d (%d) => r%d (addr: %d)",
+	  r1, get_register(r1), r2, get_register(r2));
+  return tr_string;
+}
+
+static char *load_string( int r1, int r2, int value ) {
+  sprintf(tr_string,"r%d (addr: %d) => r%d (%d)",r1,get_register(r1),r2,value);
+  return tr_string;
+}
+
+static char *one_op_string( int r1, int r2, int value ) {
+  sprintf(tr_string,"r%d (%d) => r%d (%d)", r1, get_register(r1), r2, value);
+  return tr_string;
+}
+
+static char *two_op_string( int r1, int r2, int r3, int value ) {
+  sprintf(tr_string,"r%d (%d), r%d (%d) => r%d (%d)",
+	  r1, get_register(r1),
+	  r2, get_register(r2), 
+	  r3,value);
+  return tr_string;
+}
+
+static char *output_string( int c1, int val ) {
+  sprintf(tr_string,"%d (%d)",c1,val);
+  return tr_string;
+}
+
+static char *br_string( char *l1 ) {
+  sprintf(tr_string,"-> %s",l1);
+  return tr_string;
+}
+
+static char *cbr_string( int r1, char *l1, char *l2, int value ) {
+  if (value == 1)
+    sprintf(tr_string,"r%d (%d) -> %s*, %s",r1,get_register(r1),l1,l2);
+  else 
+    sprintf(tr_string,"r%d (%d) -> %s, %s*",r1,get_register(r1),l1,l2);
+  return tr_string;
+}
+
+ static char *i2i_string( int r1, int r2, int v2 ){
+   sprintf(tr_string,"r%d (%d) => r%d (%d)",r1,get_register(r1),r2,v2);
+   return tr_string;
+ }
+
+/* Execute a single operation */
+Change* execute_operation(Operation* op)
+{
+    Change* effects;
+    Change* effect_ptr;
+    int i;
+    int address;
+
+    op_count++;
+
+    if (permitted_opcode[op->opcode] == 0) {
+      fprintf(stderr,"\nSimulator opcode violation.\n");
+      fprintf(stderr,
+	      "Opcode '%s' is not supported in this version.\n",
+	      opcode_specs[op->opcode].string);
+      die_quickly(-1);
+    }
+
+
+    /* This is a big, ugly switch statement that deals with every operation */
+    switch(op->opcode)
+    {
+	case NOP:
+	  trace_operation("nop","");
+	  return NULL;
+	  break;
+
+	case ADD:
+	  effects = onereg(op);
+	  effects->value = get_register(op->srcs->value) + 
+	      get_register(op->srcs->next->value);
+	  trace_operation("add",two_op_string(op->srcs->value,op->srcs->next->value,
+					      op->defs->value, effects->value));
+	  return effects;
+	  break;
+
+	case SUB:
+	  effects = onereg(op);
+	  effects->value = get_register(op->srcs->value) - 
+	      get_register(op->srcs->next->value);
+	  trace_operation("sub",two_op_string(op->srcs->value,op->srcs->next->value,
+					      op->defs->value, effects->value));
+	  return effects;
+	  break;
+
+	case MULT:
+	  effects = onereg(op);
+	  effects->value = get_register(op->srcs->value) * 
+	      get_register(op->srcs->next->value);
+	  trace_operation("mult",
+			  two_op_string(op->srcs->value,op->srcs->next->value,
+					op->defs->value, effects->value));
+	  mult_op_count++;
+	  return effects;
+	  break;
+
+	case DIV:
+	  effects = onereg(op);
+	  effects->value = get_register(op->srcs->value) / 
+	      get_register(op->srcs->next->value);
+	  trace_operation("div",two_op_string(op->srcs->value,op->srcs->next->value,
+					      op->defs->value, effects->value));
+	  return effects;
+	  break;	  
+
+	case ADDI:
+	  effects = onereg(op);
+	  effects->value = get_register(op->srcs->value) + op->consts->value;
+	  trace_operation("addI",addi_string(op->srcs->value,op->consts->value,
+					     op->defs->value,effects->value));
+	  return effects;
+	  break;
+
+	case SUBI:
+	  effects = onereg(op);
+	  effects->value = get_register(op->srcs->value) - op->consts->value;
+	  trace_operation("subI",addi_string(op->srcs->value,op->consts->value,
+					     op->defs->value,effects->value));
+	  return effects;
+	  break;
+	  
+	case MULTI:
+	  effects = onereg(op);
+	  effects->value = get_register(op->srcs->value) * op->consts->value;
+	  trace_operation("multI",addi_string(op->srcs->value,op->consts->value,
+					     op->defs->value,effects->value));
+	  return effects;
+	  break;
+
+	case DIVI:
+	  effects = onereg(op);
+	  effects->value = get_register(op->srcs->value) / op->consts->value;
+	  trace_operation("divI",addi_string(op->srcs->value,op->consts->value,
+					     op->defs->value,effects->value));
+	  return effects;
+	  break;
+
+	case LSHIFT:
+	  effects = onereg(op);
+	  effects->value = get_register(op->srcs->value) << 
+	      get_register(op->srcs->next->value);
+	  trace_operation("lshift",two_op_string(op->srcs->value,op->srcs->next->value,
+					      op->defs->value, effects->value));
+	  return effects;
+	  break;
+
+	case LSHIFTI:
+	  effects = onereg(op);
+	  effects->value = get_register(op->srcs->value) << op->consts->value;
+	  trace_operation("lshiftI",addi_string(op->srcs->value,op->consts->value,
+					     op->defs->value,effects->value));
+	  return effects;
+	  break;
+
+	case RSHIFT:
+	  effects = onereg(op);
+	  effects->value = get_register(op->srcs->value) >> 
+	      get_register(op->srcs->next->value);
+	  trace_operation("rshift",two_op_string(op->srcs->value,op->srcs->next->value,
+					      op->defs->value, effects->value));
+	  return effects;
+	  break;
+
+	case RSHIFTI:
+	  effects = onereg(op);
+	  effects->value = get_register(op->srcs->value) >> op->consts->value;
+	  trace_operation("lshiftI",addi_string(op->srcs->value,op->consts->value,
+					     op->defs->value,effects->value));
+	  return effects;
+	  break;
+
+        case AND:
+	  effects = onereg(op);
+	  effects->value = get_register(op->srcs->value) && 
+	      get_register(op->srcs->next->value);
+	  trace_operation("and",two_op_string(op->srcs->value,op->srcs->next->value,
+					      op->defs->value, effects->value));
+	  return effects;
+	  break;
+
+        case ANDI:
+	  effects = onereg(op);
+	  effects->value = get_register(op->srcs->value) && op->consts->value;
+	  trace_operation("andI",addi_string(op->srcs->value,op->consts->value,
+					     op->defs->value,effects->value));
+	  return effects;
+	  break;
+
+        case OR:
+	  effects = onereg(op);
+	  effects->value = get_register(op->srcs->value) || 
+	      get_register(op->srcs->next->value);
+	  trace_operation("or",two_op_string(op->srcs->value,op->srcs->next->value,
+					      op->defs->value, effects->value));
+	  return effects;
+	  break;
+
+        case ORI:
+	  effects = onereg(op);
+	  effects->value = get_register(op->srcs->value) || op->consts->value;
+	  trace_operation("orI",addi_string(op->srcs->value,op->consts->value,
+					     op->defs->value,effects->value));
+	  return effects;
+	  break;
+
+        case NOT:
+	  effects = onereg(op);
+	  effects->value = get_register(op->srcs->value);
+	  if (effects->value)
+	    effects->value = 0;
+          else 
+	    effects->value = 1;
+	  trace_operation("not",one_op_string(op->srcs->value,op->defs->value,
+					       effects->value));
+	  return effects;
+	  break;
+
+	case LOADI:
+	  effects = onereg(op);
+	  effects->value = op->consts->value;
+	  trace_operation("loadI",immed_string(op->consts->value,op->defs->value,
+					       effects->value));
+	  return effects;
+	  break;
+
+	case LOAD:
+	  effects = onereg(op);
+	  address = get_register(op->srcs->value);
+	  if ((address % 4) != 0) 
+	    complain_and_die("load");
+
+	  effects->value = get_word(address);
+	  trace_operation("load",load_string(op->srcs->value,op->defs->value,
+	      effects->value));
+	  memory_op_count++;
+	  return effects;
+	  break;
+
+	case LOADAI:
+	  effects = onereg(op);
+	  address = get_register(op->srcs->value) + op->consts->value;
+	  if ((address % 4) != 0)
+	    complain_and_die("loadAI");
+
+	  effects->value = get_word(address);
+	  trace_operation("loadAI",addi_string(op->srcs->value,op->consts->value,
+					     op->defs->value,effects->value));
+	  memory_op_count++;
+	  return effects;
+	  break;
+
+	case LOADAO:
+	  effects = onereg(op);
+	  address = get_register(op->srcs->value) 
+	          + get_register(op->srcs->next->value);
+	  if ((address % 4) != 0)
+	    complain_and_die("loadAO");
+
+	  effects->value = get_word(get_register(op->srcs->value) +
+				    get_register(op->srcs->next->value));
+	  trace_operation("loadAO",
+			  two_op_string(op->srcs->value,op->srcs->next->value,
+					op->defs->value, effects->value));
+	  memory_op_count++;
+	  return effects;
+	  break;
+
+	case CLOAD:
+	  effects = onereg(op);
+	  effects->value = get_memory(get_register(op->srcs->value));
+	  trace_operation("cload",load_string(op->srcs->value,op->defs->value,
+	      effects->value));
+	  memory_op_count++;
+	  return effects;
+	  break;
+
+	case CLOADAI:
+	  effects = onereg(op);
+	  effects->value = get_memory(get_register(op->srcs->value) +
+				      op->consts->value);
+	  trace_operation("cloadAI",
+			  addi_string(op->srcs->value,op->consts->value,
+				      op->defs->value,effects->value));
+	  memory_op_count++;
+	  return effects;
+	  break;
+
+	case CLOADAO:
+	  effects = onereg(op);
+	  effects->value = get_memory(get_register(op->srcs->value) +
+				      get_register(op->srcs->next->value));
+	  trace_operation("cloadAO",StringFromInt(effects->value));
+	  memory_op_count++;
+	  return effects;
+	  break;
+	  
+	case STORE:
+	  effect_ptr = NULL;
+	  address = get_register(op->defs->value);
+	  if ((address % 4) != 0)
+	    complain_and_die("store");
+
+	  for(i=0;i<4;i++)
+	  {
+	      effects = storeop(op);
+	      effects->value = (get_register(op->srcs->value) << (8*i)) >> 24;
+	      effects->location = get_register(op->defs->value) + i;
+	      effects->next = effect_ptr;
+	      effect_ptr = effects;
+	  }
+	  trace_operation("store",store_string(op->srcs->value,op->defs->value,
+					       get_register(op->srcs->value)));
+	  memory_op_count++;
+	  return effects;
+	  break;
+
+	case STOREAI:
+	  effect_ptr = NULL;
+          address = get_register(op->defs->value) + op->consts->value;
+	  if ((address % 4) != 0)
+	    complain_and_die("storeAI");
+
+	  for(i=0;i<4;i++)
+	  {
+	      effects = storeop(op);
+	      effects->value = (get_register(op->srcs->value) << (8*i)) >> 24;
+	      effects->location = get_register(op->defs->value) + 
+		  op->consts->value + i;
+	      effects->next = effect_ptr;
+	      effect_ptr = effects;
+	  }
+	  trace_operation("storeAI",addi_string(op->srcs->value,op->consts->value,
+					     op->defs->value,effects->value));
+	  memory_op_count++;
+	  return effects;
+	  break;
+
+	case STOREAO:
+	  effect_ptr = NULL;
+          address = get_register(op->defs->value) 
+	      + get_register(op->defs->next->value);
+	  if ((address % 4) != 0)
+	    fprintf(stderr,
+		    "storeAO operation at %d attempts non-aligned access.\n",
+		    cycle_count);	   
+
+	  for(i=0;i<4;i++)
+	  {
+	      effects = storeop(op);
+	      effects->value = (get_register(op->srcs->value) << (8*i)) >> 24;
+	      effects->location = get_register(op->defs->value) + 
+		  get_register(op->defs->next->value) + i;
+	      effects->next = effect_ptr;
+	      effect_ptr = effects;
+	  }
+	  trace_operation("div",
+			  two_op_string(op->srcs->value,op->srcs->next->value,
+					      op->defs->value, effects->value));
+	  memory_op_count++;
+	  return effects;
+	  break;
+
+	case CSTORE:
+	  effects = storeop(op);
+	  effects->value = (get_register(op->srcs->value) << 24) >> 24;
+	  effects->location = get_register(op->defs->value);
+	  effects->next = NULL;
+	  trace_operation("cstore",store_string(op->srcs->value,op->defs->value,
+						effects->value));
+	  memory_op_count++;
+	  return effects;
+	  break;
+
+	case CSTOREAI:
+	  effects = storeop(op);
+	  effects->value = (get_register(op->srcs->value) << 24) >> 24;
+	  effects->location = get_register(op->defs->value) + op->consts->value;
+	  effects->next = NULL;
+	  trace_operation("cstoreAI",addi_string(op->srcs->value,op->consts->value,
+					     op->defs->value,effects->value));
+	  memory_op_count++;
+	  return effects;
+	  break;
+
+	case CSTOREAO:
+	  effects = storeop(op);
+	  effects->value = (get_register(op->srcs->value) << 24) >> 24;
+	  effects->location = get_register(op->defs->value) + 
+	      get_register(op->defs->next->value);
+	  effects->next = NULL;
+	  trace_operation("cstoreAO",
+			  two_op_string(op->srcs->value,op->srcs->next->value,
+					op->defs->value, effects->value));
+	  memory_op_count++;
+	  return effects;
+	  break;
+
+	case BR:
+	  effects = new_change();
+	  effects->type = BRANCH;
+	  effects->target = (get_label(op->labels->value))->target;
+	  effects->cycles_away = opcode_specs[BR].latency;
+	  effects->next = NULL;
+	  effects->issue_cycle = cycle_count;
+	  trace_operation("br",br_string((get_label(op->labels->value))->string));
+	  branch_op_count++;
+	  return effects;
+	  break;
+
+	case CBR:
+	  effects = new_change();
+	  effects->type = BRANCH;
+	  if (get_register(op->srcs->value)) {
+	    effects->target = (get_label(op->labels->value))->target;
+	  }
+	  else {
+	    effects->target = (get_label(op->labels->next->value))->target;
+	  }
+	  effects->cycles_away = opcode_specs[BR].latency;
+	  effects->next = NULL;
+	  effects->issue_cycle = cycle_count;
+	  trace_operation("cbr",
+			  cbr_string(op->srcs->value,
+				     (get_label(op->labels->value))->string,
+				    (get_label(op->labels->next->value))->string,
+				     get_register(op->srcs->value)));
+	  branch_op_count++;
+	  return effects;
+	  break;
+
+	case CMPLT:
+	  effects = onereg(op);
+	  if (get_register(op->srcs->value) < 
+	      get_register(op->srcs->next->value))
+	      effects->value = 1;
+	  else
+	      effects->value = 0;
+
+	  trace_operation("cmp_LT",two_op_string(op->srcs->value,
+						 op->srcs->next->value,
+						 op->defs->value,
+						 effects->value));
+	  return effects;
+	  break;
+	  
+	case CMPLE:
+	  effects = onereg(op);
+	  if (get_register(op->srcs->value) <= 
+	      get_register(op->srcs->next->value))
+	      effects->value = 1;
+	  else
+	      effects->value = 0;
+
+	  trace_operation("cmp_LE",two_op_string(op->srcs->value,
+						 op->srcs->next->value,
+						 op->defs->value,
+						 effects->value));
+	  return effects;
+	  break;
+
+	case CMPEQ:
+	  effects = onereg(op);
+	  if (get_register(op->srcs->value) == 
+	      get_register(op->srcs->next->value))
+	      effects->value = 1;
+	  else
+	      effects->value = 0;
+
+	  trace_operation("cmp_EQ",two_op_string(op->srcs->value,
+						 op->srcs->next->value,
+						 op->defs->value,
+						 effects->value));
+	  return effects;
+	  break;
+
+	case CMPNE:
+	  effects = onereg(op);
+	  if (get_register(op->srcs->value) != 
+	      get_register(op->srcs->next->value))
+	      effects->value = 1;
+	  else
+	      effects->value = 0;
+
+	  trace_operation("cmp_NE",two_op_string(op->srcs->value,
+						 op->srcs->next->value,
+						 op->defs->value,
+						 effects->value));
+	  return effects;
+	  break;
+
+	case CMPGE:
+	  effects = onereg(op);
+	  if (get_register(op->srcs->value) >= 
+	      get_register(op->srcs->next->value))
+	      effects->value = 1;
+	  else
+	      effects->value = 0;
+
+	  trace_operation("cmp_GE",two_op_string(op->srcs->value,
+						 op->srcs->next->value,
+						 op->defs->value,
+						 effects->value));
+	  return effects;
+	  break;
+
+	case CMPGT:
+	  effects = onereg(op);
+	  if (get_register(op->srcs->value) > 
+	      get_register(op->srcs->next->value))
+	      effects->value = 1;
+	  else
+	      effects->value = 0;
+
+	  trace_operation("cmp_GT",two_op_string(op->srcs->value,
+						 op->srcs->next->value,
+						 op->defs->value,
+						 effects->value));
+	  return effects;
+	  break;
+
+	case I2I:
+	  effects = onereg(op);
+	  effects->value = get_register(op->srcs->value);
+	  trace_operation("i2i",i2i_string(op->srcs->value,
+					   op->defs->value,
+					   effects->value));
+	  return effects;
+	  break;
+
+	case C2C:
+	case C2I:
+	case I2C:
+	  effects = onereg(op);
+	  effects->value = (get_register(op->srcs->value) << 24) >> 24;
+	  trace_operation("c2i",StringFromInt(effects->value));
+	  return effects;
+	  break;
+	  
+	case OUTPUT:
+	  effects = new_change();
+	  effects->type = DISPLAY;
+	  effects->cycles_away = opcode_specs[OUTPUT].latency;
+	  effects->next = NULL;
+	  effects->value = get_word(op->consts->value);
+	  effects->issue_cycle = cycle_count;
+	  trace_operation("output",
+			  output_string(op->consts->value,effects->value));
+	  output_op_count++;
+	  return effects;
+	  break;
+	  
+	case COUTPUT:
+	  effects = new_change();
+	  effects->type = DISPLAY;
+	  effects->cycles_away = opcode_specs[OUTPUT].latency;
+	  effects->next = NULL;
+	  effects->value = get_memory(op->consts->value);
+	  effects->issue_cycle = cycle_count;
+	  trace_operation("coutput",
+			  output_string(op->consts->value,effects->value));
+	  output_op_count++;
+	  return effects;
+	  break;
+
+	default:
+	  fprintf(stderr,"Simulator Error: Invalid opcode encountered in execute_operation.");
+	  return NULL;
+	  break;
+      }
+}
+
+/* onereg creates most of a change structure for the common case where 
+   a single register is defined. */
+Change* onereg(Operation* op)
+{
+    Change* effect = new_change();
+    effect->type = REGISTER;
+    effect->location = op->defs->value;
+    effect->cycles_away = opcode_specs[op->opcode].latency;
+    effect->next = NULL;
+    effect->issue_cycle = cycle_count;
+    return effect;
+}
+
+/* storeop creates most of a change structure for a store operation */
+Change* storeop(Operation* op)
+{
+    Change* effect = new_change();
+    effect->type = MEMORY;
+    effect->cycles_away = opcode_specs[op->opcode].latency;
+    effect->next = NULL;
+    effect->issue_cycle = cycle_count;
+    return effect;
+}
+
+
+
+
+/* Returns 1 if there is an outstanding branch instruction */
+int branch_stall(void)
+{
+    return pending_branches > 0;
+}
+
+/* Adds the effects of a newly issued instruction to the ring, in the
+   bucket for the cycle where cycles_away reaches zero, and marks the
+   registers and memory they write as busy until then */
+void schedule_changes(Change* changes)
+{
+    Change* next;
+    int due, slot, i;
+
+    while(changes)
+    {
+	next = changes->next;
+	changes->next = NULL;
+
+	due = cycle_count + changes->cycles_away - 1;
+	slot = due % EFFECT_RING;
+
+	if (ring_tail[slot])
+	    ring_tail[slot]->next = changes;
+	else
+	    ring_head[slot] = changes;
+	ring_tail[slot] = changes;
+	pending_effects++;
+
+	switch(changes->type)
+	{
+	    case REGISTER:
+	      if (changes->location < 0 || changes->location >= NUM_REGISTERS)
+		note_wild(REGISTER,changes->location,due + 1);
+	      else if (reg_ready_cycle[changes->location] < due + 1)
+		reg_ready_cycle[changes->location] = due + 1;
+	      break;
+	    case MEMORY:
+	      if (changes->location < 0 || changes->location >= MEMORY_SIZE)
+		note_wild(MEMORY,changes->location,due + 1);
+	      else if (mem_ready_cycle[changes->location] < due + 1)
+		mem_ready_cycle[changes->location] = due + 1;
+	      break;
+	    case WORD:
+	      for(i=0;i<4;i++)
+		if (changes->location+i < 0 || changes->location+i >= MEMORY_SIZE)
+		  note_wild(MEMORY,changes->location+i,due + 1);
+		else if (mem_ready_cycle[changes->location+i] < due + 1)
+		  mem_ready_cycle[changes->location+i] = due + 1;
+	      break;
+	    case BRANCH:
+	      pending_branches++;
+	      break;
+	    default:
+	      break;
+	}
+
+	changes = next;
+    }
+}
+
+static void note_wild(Effect_Type type, int location, int ready)
+{
+    if (wild_count == wild_cap) {
+      wild_cap = wild_cap ? 2*wild_cap : 8;
+      wild = (Wild_Write*)realloc(wild,wild_cap*sizeof(Wild_Write));
+    }
+    wild[wild_count].type = type;
+    wild[wild_count].location = location;
+    wild[wild_count].ready = ready;
+    wild_count++;
+}
+
+/* Returns 1 if no pending write outside the machine hits the location */
+static int wild_ready(Effect_Type type, int location)
+{
+    int i;
+
+    for(i=0;i<wild_count;i++)
+      if (wild[i].type == type && wild[i].location == location &&
+	  cycle_count < wild[i].ready)
+	return 0;
+    return 1;
+}
+
+/* Executes, in issue order, the changes that take effect this cycle */
+void execute_changes(Instruction** code_ptr)
+{
+    int slot = cycle_count % EFFECT_RING;
+    Change* changes = ring_head[slot];
+    Change* next;
+
+    ring_head[slot] = NULL;
+    ring_tail[slot] = NULL;
+
+    while(changes)
+    {
+	/* Perform effect */
+	switch(changes->type)
+	{
+	    case REGISTER:
+	      set_register(changes->location,changes->value);
+	      break;
+	    case MEMORY:
+	      set_memory(changes->location,changes->value);
+	      break;
+	    case WORD:
+	      if (changes->location >= 0 && changes->location <= MEMORY_SIZE - 4)
+		set_word(changes->location,changes->value);
+	      else
+		store_bytes(changes->location,changes->value);
+	      break;
+	    case BRANCH:
+	      *code_ptr = changes->target;
+	      pending_branches--;
+	      break;
+	    case DISPLAY:
+	      if (output_hook)
+		output_hook(changes->value);
+	      else if (tracing)
+		fprintf(stdout,"\noutput generates => %d",changes->value);
+	      else
+		fprintf(stdout,"%d\n",changes->value);
+	      break;
+	}
+
+	/* report delayed effect */
+	if (tracing && changes->issue_cycle != cycle_count)
+	  trace_effect(changes->issue_cycle);
+
+	/* Delete change record */
+	next = changes->next;
+	free_change(changes);
+	pending_effects--;
+	changes = next;
+    }
+}
+
+
+/* Applies a word store one byte at a time, in the order the four MEMORY
+   effects of a store are applied, so an out-of-range store fails on the
+   same address it always did */
+static void store_bytes(int location, int value)
+{
+    int i;
+
+    for(i=3;i>=0;i--)
+	set_memory(location+i,(char)((value << (8*i)) >> 24));
+}
+
+static Change* new_change(void)
+{
+    Change* block;
+    int i;
+
+    if (!free_changes) {
+      block = (Change*)malloc(CHANGE_BLOCK*sizeof(Change));
+      if (!block) {
+	fprintf(stderr,"Simulator Error: out of memory for pending effects.\n");
+	sim_exit(1);
+      }
+      for(i=0;i<CHANGE_BLOCK;i++) {
+	block[i].next = free_changes;
+	free_changes = &block[i];
+      }
+    }
+
+    block = free_changes;
+    free_changes = block->next;
+    return block;
+}
+
+static void free_change(Change* change)
+{
+    change->next = free_changes;
+    free_changes = change;
+}
+
+/* Issues one decoded effect */
+static void issue_effect(Effect_Type type, int location, int value, int latency)
+{
+    Change* effect = new_change();
+
+    effect->type = type;
+    effect->location = location;
+    effect->value = value;
+    effect->cycles_away = latency;
+    effect->next = NULL;
+    effect->issue_cycle = cycle_count;
+    schedule_changes(effect);
+}
+
+/* The execute loop for decoded blocks.  It keeps the cycle-by-cycle
+   behaviour of simulate(): the same interlocks are checked in the same
+   order, and effects go through the same ring and scoreboard.  Each
+   operation jumps straight to its handler through a table of label
+   addresses (a GNU C extension, like the rest of this build). */
+static void simulate_decoded(Decoded_Op* ops, int count,
+			     int* instruction_count, int* operation_count)
+{
+    static void* handler[] = {
+      [D_NOP] = &&do_nop, [D_ADD] = &&do_add, [D_SUB] = &&do_sub,
+      [D_MULT] = &&do_mult, [D_LSHIFT] = &&do_lshift,
+      [D_RSHIFT] = &&do_rshift, [D_LOADI] = &&do_loadi,
+      [D_LOAD] = &&do_load, [D_STORE] = &&do_store,
+      [D_OUTPUT] = &&do_output
+    };
+    Decoded_Op* op = ops;
+    Decoded_Op* end = ops + count;
+    int value, address;
+
+    while(op < end)
+    {
+	if (stall_on_memory &&
+	    ((op->kind == D_LOAD && !word_ready(get_register(op->src1))) ||
+	     (op->kind == D_OUTPUT && !mem_ready(op->constant)))) {
+	    if (profiling)
+	      count_stall(op->line,1);
+	    goto next_cycle;
+	}
+
+	/* sources, a store's address, and the antidependence on defs */
+	if (stall_on_registers &&
+	    (!reg_ready(op->src1) || !reg_ready(op->src2) || !reg_ready(op->def))) {
+	    if (profiling)
+	      count_stall(op->line,0);
+	    goto next_cycle;
+	}
+
+	(*instruction_count)++;
+	(*operation_count)++;
+	goto *handler[op->kind];
+
+      do_add:
+	value = get_register(op->src1) + get_register(op->src2);
+	goto define;
+      do_sub:
+	value = get_register(op->src1) - get_register(op->src2);
+	goto define;
+      do_mult:
+	value = get_register(op->src1) * get_register(op->src2);
+	goto define;
+      do_lshift:
+	value = get_register(op->src1) << get_register(op->src2);
+	goto define;
+      do_rshift:
+	value = get_register(op->src1) >> get_register(op->src2);
+	goto define;
+      do_loadi:
+	value = op->constant;
+	goto define;
+
+      do_load:
+	address = get_register(op->src1);
+	if ((address % 4) != 0)
+	  complain_and_die("load");
+	value = get_word(address);
+	goto define;
+
+      do_store:
+	address = get_register(op->def);
+	if ((address % 4) != 0)
+	  complain_and_die("store");
+	issue_effect(WORD,address,get_register(op->src1),op->latency);
+	goto issued;
+
+      do_output:
+	issue_effect(DISPLAY,0,get_word(op->constant),op->latency);
+	goto issued;
+
+      define:
+	issue_effect(REGISTER,op->def,value,op->latency);
+      do_nop:
+      issued:
+	op++;
+
+      next_cycle:
+	execute_changes(NULL);
+	cycle_count++;
+    }
+}
+
+void complain_and_die(char *op) {
+  fflush(stdout);
+  fprintf(stderr,
+	  "\nError: operation '%s' in cycle %d attempted a non-aligned access.\n",
+	  op, cycle_count);
+  fprintf(stderr,"Execution halts.\n\n");
+  sim_exit(-1);
+}
+
+void die_quickly(int code) {
+  if (!sim_abort) {
+    fclose(stdin);
+    if (DataFileName > 0)
+      (void) remove(filename);
+  }
+  sim_exit(code);
+}
+
+/* Returns the simulator to its initial state so that simulate() can run
+   another block; pending effects go back to the free list */
+void reset_simulator(void)
+{
+    Change* next;
+    int slot;
+
+    for(slot=0;slot<EFFECT_RING;slot++) {
+      while(ring_head[slot]) {
+	next = ring_head[slot]->next;
+	free_change(ring_head[slot]);
+	ring_head[slot] = next;
+      }
+      ring_tail[slot] = NULL;
+    }
+    pending_effects = 0;
+    pending_branches = 0;
+
+    free_pages(reg_ready_cycle,NUM_REGISTERS*sizeof(int));
+    free_pages(mem_ready_cycle,MEMORY_SIZE*sizeof(int));
+    reg_ready_cycle = NULL;
+    mem_ready_cycle = NULL;
+    free(wild);
+    wild = NULL;
+    wild_count = wild_cap = 0;
+    free(decoded);
+    decoded = NULL;
+
+    cycle_count = 0;
+    code_check_flag = 0;
+    first_op = 0;
+    last_traced_op = -1;
+    last_traced_effect = -1;
+}
+
+#ifndef SIM_LIBRARY
+int IntFromString(char *p, int *legal) {
+  int value;
+  char *endptr;
+
+  value = (int) strtol(p,&endptr,10);
+  if (*p != '\0' && *endptr == '\0')
+    *legal = 1;
+  else 
+    *legal = 0;
+
+  return value;
+}
+
+static int FileCopy( FILE *out, FILE *in ) {
+
+  char    *Line = NULL;
+  size_t  LineCap = 0;
+  size_t  LineLen;
+  int     count = 0;
+
+  LineLen = getline(&Line,&LineCap,in);
+
+  while (((int) LineLen) > 0) {
+    fwrite(Line, LineLen, 1, out);
+    LineLen = getline(&Line,&LineCap,in);
+    count++;
+  }
+
+  return count;
+}
+#endif /* SIM_LIBRARY */
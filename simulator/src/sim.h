@@ -0,0 +1,130 @@
+/*  sim.h
+ *  Header file for a simulator of the ILOC subset defined in
+ *  "Engineering a Compiler" by Cooper and Torczon
+ *  written by Todd Waterman
+ *  11/30/00 */
+
+#ifndef _SIM_H_
+#define _SIM_H_
+
+/* configuration issues */  /* CLASS is a string, versions are numbers */
+#define CLASS "412 Lab 2"
+#define MAJOR_VERSION 2024
+#define MINOR_VERSION 1
+
+/* defines machine constraints: values are LAB1 and LAB3; LAB1 unless
+   built with -DLAB3 (make sim3)  */
+#ifndef LAB3
+#define LAB1
+#endif
+
+/* These flags determine what the simulator stalls on */
+int stall_on_branches;
+int stall_on_memory;
+int stall_on_registers;
+
+/* and enable a verbose cycle-by-cycle trace */
+int tracing;
+
+#define TEMPDIR "/tmp"
+
+/* WORD writes an aligned word in one effect; only the decoded loop
+   issues it */
+typedef enum effect_type {REGISTER=0,MEMORY,BRANCH,DISPLAY,WORD} Effect_Type; 
+
+/* This keeps track of assignments to registers or memory so 
+   parallel operations can be simulated */
+typedef struct change {
+    Effect_Type type;
+    int location;
+    int value;
+    Instruction* target;
+    int cycles_away;
+    struct change* next;
+    int issue_cycle;  /* for tracing */
+} Change;
+
+/* Pending effects are kept in a ring indexed by the cycle in which they
+   take effect; no latency may reach EFFECT_RING cycles */
+#define EFFECT_RING 16
+
+/* When set, output operations hand their values to output_hook and
+   simulate() prints nothing; used by the simulator library (simlib.h) */
+void (*output_hook)(int value);
+
+/* When set, simulate() counts the cycles each source line spends
+   waiting on a register or a memory interlock */
+int profiling;
+
+/* Write the counts as "line register-cycles memory-cycles", one line per
+   source line that stalled; returns 0 if the file could not be written */
+int write_stall_profile(char* name);
+
+/* Totals from the last call to simulate() */
+int instructions_executed;
+int operations_executed;
+
+/* Print a usage message */
+void print_help();
+
+/* Set stall flags */
+void set_stall_mode(int);
+
+/* Simulate the code and output results to standard out */
+void simulate(Instruction* code);
+
+/* Returns 1 if the instruction uses a register that is not ready */
+int register_stall(Instruction*);
+
+/* Returns 1 if all operands in the list are ready, and 
+   return 0 if they are not */
+int list_of_operands_ready(Operand* reg);
+ 
+/* Returns 1 if the instruction uses a memory address that is not ready */
+int memory_stall(Instruction*);
+
+/* Returns 1 if the instruction uses a register that is already pending */
+/* in the effects list, as that would require a stall */
+int antidependence_stall(Instruction*);
+
+/* Returns 1 if no pending effect writes the register */
+int reg_ready(int register);
+
+/* Returns 1 if no pending effect writes the memory location */
+int mem_ready(int location);
+
+/* Returns 1 if no pending effect writes the word of memory */
+int word_ready(int location);
+
+/* Execute all operations in a single instruction */
+Change* execute_instruction(Instruction* inst, int* op_count);
+
+/* Execute a single operation */
+Change* execute_operation(Operation* op);
+
+/* onereg creates most of a change structure for the common case where 
+   a single register is defined. */
+Change* onereg(Operation* op);
+
+/* storeop creates most of a change structure for a store operation */
+Change* storeop(Operation* op);
+
+/* Returns 1 if there is an outstanding branch instruction */
+int branch_stall(void);
+
+/* Adds the effects of a newly issued instruction to the pending ring
+   and the ready-cycle scoreboard */
+void schedule_changes(Change*);
+
+/* Executes the changes that take effect in the current cycle */
+void execute_changes(Instruction**);
+
+/* Returns the simulator to its initial state so that simulate() can
+   run another block */
+void reset_simulator(void);
+
+/* Returns false if machine constraints are violated. */
+int check_machine_constraints(Instruction*);
+
+#endif /* _SIM_H_ */
+
@@ -0,0 +1,99 @@
+/*  simcheck.c
+ *  Checks allocated blocks against the original in one process:
+ *
+ *     simcheck [-r NUM] [-s NUM] original.i allocated.i ...
+ *
+ *  The original runs once with the input from its "//SIM INPUT:" line;
+ *  each allocated block runs with the same input (and -r NUM, as the
+ *  lab 2 test script does) and must print the same values.  Prints the
+ *  cycle count of each correct block; exits with the number of failures */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "simlib.h"
+
+static char* read_file(const char* name, size_t* length)
+{
+    FILE* f = fopen(name,"r");
+    char* text;
+
+    if (!f) {
+      fprintf(stderr,"simcheck: could not open '%s'.\n",name);
+      return NULL;
+    }
+    fseek(f,0L,SEEK_END);
+    *length = ftell(f);
+    rewind(f);
+    text = (char*)malloc(*length + 1);
+    if (text && fread(text,1,*length,f) != *length) {
+      free(text);
+      text = NULL;
+    }
+    fclose(f);
+    return text;
+}
+
+static int same_outputs(Sim_Result* a, Sim_Result* b)
+{
+    return a->output_count == b->output_count &&
+      memcmp(a->outputs,b->outputs,a->output_count*sizeof(int)) == 0;
+}
+
+int main(int argc, char* argv[])
+{
+    Sim_Options options = {0, 0, 0, 0, 0};
+    Sim_Options original_options = {0, 0, 0, 0, 0};
+    Sim_Result correct, result;
+    char input[1024];
+    char* text;
+    size_t length;
+    int failures = 0;
+    int arg = 1;
+
+    while(arg + 1 < argc && argv[arg][0] == '-') {
+      if (strcmp(argv[arg],"-r") == 0)
+	options.registers = atoi(argv[arg+1]);
+      else if (strcmp(argv[arg],"-s") == 0) {
+	options.stall_mode = original_options.stall_mode = atoi(argv[arg+1]);
+	options.no_interlocks = original_options.no_interlocks =
+	  options.stall_mode == 0;
+      }
+      else
+	break;
+      arg += 2;
+    }
+
+    if (argc - arg < 2) {
+      fprintf(stderr,"Usage: simcheck [-r NUM] [-s NUM] original.i allocated.i ...\n");
+      return -1;
+    }
+
+    text = read_file(argv[arg],&length);
+    if (!text)
+      return -1;
+    if (!sim_find_input(text,length,input,sizeof(input)))
+      input[0] = '\0';
+    if (sim_run(text,length,input,&original_options,&correct) != 0) {
+      fprintf(stderr,"simcheck: original block '%s' did not run.\n",argv[arg]);
+      return -1;
+    }
+    free(text);
+
+    for(arg++;arg<argc;arg++) {
+      text = read_file(argv[arg],&length);
+      if (text && sim_run(text,length,input,&options,&result) == 0 &&
+	  same_outputs(&correct,&result))
+	printf("%s: correct in %d cycles\n",argv[arg],result.cycles);
+      else {
+	printf("%s: incorrect\n",argv[arg]);
+	failures++;
+      }
+      if (text)
+	sim_free_result(&result);
+      free(text);
+    }
+
+    sim_free_result(&correct);
+    return failures;
+}
@@ -0,0 +1,175 @@
+/*  simlib.c
+ *  The ILOC simulator as a library; see simlib.h */
+
+#define _GNU_SOURCE  /* memmem */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <setjmp.h>
+#include "instruction.h"
+#include "machine.h"
+#include "sim.h"
+#include "simlib.h"
+
+/* shared with sim.c and machine.c */
+extern int code_check;
+extern int code_check_flag;
+extern int cycle_count;
+
+/* from the flex scanner */
+extern FILE* yyin;
+void yyrestart(FILE*);
+
+static Sim_Result* current;
+static int output_capacity;
+
+static void collect_output(int value)
+{
+    if (current->output_count == output_capacity) {
+      output_capacity = output_capacity ? 2*output_capacity : 64;
+      current->outputs = (int*)realloc(current->outputs,
+				       output_capacity*sizeof(int));
+      if (!current->outputs) {
+	fprintf(stderr,"Simulator Error: out of memory for outputs.\n");
+	sim_exit(1);
+      }
+    }
+    current->outputs[current->output_count++] = value;
+}
+
+/* Apply "-i address value ..." to memory, with the checks main() makes;
+   returns 0 on anything else */
+static int load_input(const char* input)
+{
+    char* copy;
+    char* word;
+    char* end;
+    long value;
+    int location;
+    int ok = 1;
+
+    if (!input)
+      return 1;
+
+    copy = strdup(input);
+    word = strtok(copy," \t\r\n");
+    if (word && strcmp(word,"-i") == 0) {
+      word = strtok(NULL," \t\r\n");
+      location = word ? (int)strtol(word,&end,10) : -1;
+      if (!word || *end != '\0' || location < 0 || location > MEMORY_SIZE - 1 ||
+	  location % 4 != 0) {
+	fprintf(stderr,"\nError: bad start address in -i input.\n");
+	ok = 0;
+      }
+      while(ok && (word = strtok(NULL," \t\r\n"))) {
+	value = strtol(word,&end,10);
+	if (*end != '\0') {
+	  fprintf(stderr,"\nError: '%s' in -i input is not a number.\n",word);
+	  ok = 0;
+	  break;
+	}
+	set_word(location,(int)value);
+	location += 4;
+      }
+    }
+    else if (word) {
+      fprintf(stderr,"\nError: only -i input is supported ('%s').\n",word);
+      ok = 0;
+    }
+
+    free(copy);
+    return ok;
+}
+
+int sim_run(const char* text, size_t length, const char* input,
+	    const Sim_Options* options, Sim_Result* result)
+{
+    static const Sim_Options defaults = {0, 0, 0, 0};
+    jmp_buf abort_point;
+    Instruction* volatile code = NULL;
+    FILE* volatile in = NULL;
+
+    if (!options)
+      options = &defaults;
+
+    memset(result,0,sizeof(Sim_Result));
+    result->status = -1;
+    current = result;
+    output_capacity = 0;
+
+    if (length == 0) {
+      fprintf(stderr,"Error: \tBlock passed to the simulator is empty.\n");
+      return result->status;
+    }
+
+    if (setjmp(abort_point) == 0) {
+      sim_abort = &abort_point;
+
+      initialize_machine(options->registers,options->memory);
+      if (options->no_interlocks)
+	set_stall_mode(0);
+      else
+	set_stall_mode(options->stall_mode ? options->stall_mode : 3);
+      tracing = 0;
+      code_check = options->code_check;
+      code_check_flag = 0;
+      cycle_count = 0;
+
+      if (load_input(input)) {
+	in = fmemopen((void*)text,length,"r");
+	if (in) {
+	  yyin = in;
+	  yyrestart(in);
+	  code = parse();
+	}
+
+	if (code) {
+	  output_hook = collect_output;
+	  simulate(code);
+	  result->cycles = cycle_count;
+	  result->instructions = instructions_executed;
+	  result->operations = operations_executed;
+	  result->reassignments = code_check_flag;
+	  result->status = 0;
+	}
+      }
+    }
+
+    sim_abort = NULL;
+    output_hook = NULL;
+    current = NULL;
+    free_instructions(code);
+    if (in)
+      fclose(in);
+    yyin = stdin;
+    reset_simulator();
+    free_machine();
+
+    return result->status;
+}
+
+void sim_free_result(Sim_Result* result)
+{
+    free(result->outputs);
+    result->outputs = NULL;
+    result->output_count = 0;
+}
+
+int sim_find_input(const char* text, size_t length, char* buffer, size_t size)
+{
+    const char* line = memmem(text,length,"//SIM INPUT:",12);
+    const char* stop;
+    size_t n;
+
+    if (!line)
+      return 0;
+
+    line += 12;
+    stop = memchr(line,'\n',text + length - line);
+    n = stop ? (size_t)(stop - line) : (size_t)(text + length - line);
+    if (n >= size)
+      n = size - 1;
+    memcpy(buffer,line,n);
+    buffer[n] = '\0';
+    return 1;
+}
@@ -0,0 +1,47 @@
+/*  simlib.h
+ *  The ILOC simulator as a library: run a block held in memory and get
+ *  its outputs and cycle count back, without starting a process.
+ *
+ *  sim_run() may be called any number of times in one process; each call
+ *  starts from a fresh machine and releases everything it allocated.
+ *  It is not thread-safe: the parser and the machine are global. */
+
+#ifndef _SIMLIB_H_
+#define _SIMLIB_H_
+
+#include <stddef.h>
+
+/* Settings for one run; zero fields take the simulator's defaults */
+typedef struct sim_options {
+    int registers;      /* -r: size of the register bank */
+    int memory;         /* -m: bytes of memory */
+    int stall_mode;     /* -s: 1, 2 or 3; 0 means the lab 2 default of 3 */
+    int code_check;     /* -x: count registers assigned more than once */
+    int no_interlocks;  /* stall mode 0: stall on nothing; overrides stall_mode */
+} Sim_Options;
+
+/* What a run produced */
+typedef struct sim_result {
+    int status;         /* 0 if the block parsed and ran to completion */
+    int* outputs;       /* values printed by output operations, in order */
+    int output_count;
+    int cycles;
+    int instructions;
+    int operations;
+    int reassignments;  /* code check violations, when code_check is set */
+} Sim_Result;
+
+/* Simulate the length bytes of ILOC at text.  input holds the block's
+   "//SIM INPUT:" arguments (e.g. "-i 1024 1 2 3") or is NULL.  Returns
+   result->status; error messages still go to stderr.  Release the
+   result with sim_free_result() */
+int sim_run(const char* text, size_t length, const char* input,
+	    const Sim_Options* options, Sim_Result* result);
+
+void sim_free_result(Sim_Result* result);
+
+/* Copy the arguments from a "//SIM INPUT:" line in text into buffer;
+   returns 0 if there is no such line */
+int sim_find_input(const char* text, size_t length, char* buffer, size_t size);
+
+#endif /* _SIMLIB_H_ */